@@ -0,0 +1,92 @@
+// classCommandStats.cpp
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "classCommandStats.h"
+#include <cmath>
+#include <cstdio>
+
+std::uint64_t LatencyHistogram::percentile(const double p) const
+{
+	const std::uint64_t total = count();
+	if (total == 0) return 0;
+	const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(p / 100.0 * total)));
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i < numBuckets; ++i) {
+		seen += counts_[i].load(std::memory_order_relaxed);
+		if (seen >= rank) return std::min(highestValueIn(i), max());
+	}
+	return max(); // counts_ and total_ are updated separately
+}
+
+namespace {
+	std::string microseconds(std::uint64_t nanoseconds)
+	{
+		char text[32];
+		std::snprintf(text, sizeof(text), "%.1f", nanoseconds / 1000.0);
+		return text;
+	}
+
+	std::string percentiles(const LatencyHistogram& h, const std::string& separator)
+	{
+		return microseconds(h.percentile(50)) + separator + microseconds(h.percentile(90)) + separator + microseconds(h.percentile(99)) + separator + microseconds(h.percentile(99.9)) + separator + microseconds(h.max());
+	}
+}
+
+std::string CommandStats::textReport(std::string_view command) const
+{ // e.g. Affect: calls=12 errors=0 cached=3 in=24 out=4096 handler_us=p50/p90/p99/p99.9/max 1.2/3.4/5.6/5.6/5.6 queue_us=...; Next: ...
+	std::string report;
+	for (const auto& c : counters_) {
+		if (!command.empty() && c.first != command) continue;
+		const Counters& s = *c.second;
+		if (s.calls == 0 && command.empty()) continue;
+		if (!report.empty()) report += "; ";
+		report += c.first + ": calls=" + std::to_string(s.calls) + " errors=" + std::to_string(s.errors) + " cached=" + std::to_string(s.cacheHits)
+			+ " in=" + std::to_string(s.bytesIn) + " out=" + std::to_string(s.bytesOut)
+			+ " handler_us=p50/p90/p99/p99.9/max " + percentiles(s.handlerTime, "/") + " queue_us=p50/p90/p99/p99.9/max " + percentiles(s.queueTime, "/");
+	}
+	return report;
+}
+
+std::string CommandStats::htmlReport() const
+{
+	std::string report("<table>\n<tr><th>Command</th><th>Calls</th><th>Errors</th><th>Cached</th><th>Bytes in</th><th>Bytes out</th>"
+		"<th>Handler p50 (&micro;s)</th><th>p90</th><th>p99</th><th>p99.9</th><th>max</th>"
+		"<th>Queue p50 (&micro;s)</th><th>p90</th><th>p99</th><th>p99.9</th><th>max</th></tr>\n");
+	const std::string cellBreak("</td><td>");
+	for (const auto& c : counters_) {
+		const Counters& s = *c.second;
+		if (s.calls == 0) continue;
+		report += "<tr><td>" + c.first + cellBreak + std::to_string(s.calls) + cellBreak + std::to_string(s.errors) + cellBreak + std::to_string(s.cacheHits)
+			+ cellBreak + std::to_string(s.bytesIn) + cellBreak + std::to_string(s.bytesOut)
+			+ cellBreak + percentiles(s.handlerTime, cellBreak) + cellBreak + percentiles(s.queueTime, cellBreak) + "</td></tr>\n";
+	}
+	return report + "</table>\n";
+}
@@ -0,0 +1,112 @@
+// classCommandStats.h
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Per-command statistics of SocketServer: counts, bytes, and latency histograms, recorded without locking from
+// any session or worker thread. They are reported through the reserved Stats command and web command.
+
+#ifndef CLASS_COMMAND_STATS_H
+#define CLASS_COMMAND_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class LatencyHistogram { // HdrHistogram-style log-linear buckets of nanoseconds, each within ~3% of its values
+public:
+	static constexpr unsigned subBucketBits = 6; // 64 exact values, then 32 buckets per power of two
+	static constexpr unsigned maxValueBits = 36; // ~69 s; longer durations are recorded as the longest
+private:
+	static constexpr std::size_t halfSubBuckets = std::size_t(1) << (subBucketBits - 1);
+	static constexpr std::size_t numBuckets = (maxValueBits - subBucketBits + 2) * halfSubBuckets;
+
+	std::array<std::atomic<std::uint64_t>, numBuckets> counts_;
+	std::atomic<std::uint64_t> total_;
+	std::atomic<std::uint64_t> max_;
+
+	static std::size_t bucketOf(std::uint64_t v) {
+		const unsigned shift = std::max<int>(0, std::bit_width(v) - static_cast<int>(subBucketBits));
+		return shift * halfSubBuckets + (v >> shift);
+	}
+	static std::uint64_t highestValueIn(std::size_t bucket) {
+		const unsigned shift = (bucket < 2 * halfSubBuckets) ? 0 : bucket / halfSubBuckets - 1;
+		return ((bucket - shift * halfSubBuckets + 1) << shift) - 1;
+	}
+public:
+	LatencyHistogram() : counts_{}, total_(0), max_(0) { }
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+	void record(std::chrono::steady_clock::duration d) {
+		const std::uint64_t v = std::min<std::uint64_t>(std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()), (std::uint64_t(1) << maxValueBits) - 1);
+		counts_[bucketOf(v)].fetch_add(1, std::memory_order_relaxed);
+		total_.fetch_add(1, std::memory_order_relaxed);
+		std::uint64_t m = max_.load(std::memory_order_relaxed);
+		while (v > m && !max_.compare_exchange_weak(m, v, std::memory_order_relaxed)) { }
+	}
+	std::uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+	std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+	std::uint64_t percentile(double p) const; // in nanoseconds, e.g. percentile(99.9); 0 if empty
+};
+
+class CommandStats {
+public:
+	struct Counters {
+		std::atomic<std::uint64_t> calls{0};
+		std::atomic<std::uint64_t> errors{0};
+		std::atomic<std::uint64_t> cacheHits{0}; // answered from the ReplyCache
+		std::atomic<std::uint64_t> bytesIn{0}; // arguments
+		std::atomic<std::uint64_t> bytesOut{0}; // replies
+		LatencyHistogram handlerTime; // from the call of the handler (or the cache lookup) to its reply
+		LatencyHistogram queueTime; // from the arrival of the request to the call of its handler
+	};
+private:
+	std::map<std::string, std::unique_ptr<Counters>, std::less<>> counters_; // complete before the server is launched
+public:
+	void add(std::string_view command) { // before the server is launched
+		if (counters_.find(command) == counters_.end()) counters_.emplace(std::string(command), std::make_unique<Counters>());
+	}
+	Counters* find(std::string_view command) const { // nullptr if not registered
+		const auto it = counters_.find(command);
+		return (it == counters_.end()) ? nullptr : it->second.get();
+	}
+	std::string textReport(std::string_view command) const; // one line, for all the commands called so far if command is empty
+	std::string htmlReport() const;
+};
+
+#endif
@@ -0,0 +1,244 @@
+// classHTTPParser.cpp
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "classHTTPParser.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+bool equalsIgnoringCase(std::string_view a, std::string_view b)
+{
+	return a.length() == b.length() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+		return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+	});
+}
+
+std::string_view trim(std::string_view s)
+{ // Of spaces and tabs
+	while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+	while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+	return s;
+}
+
+bool isHexDigit(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+}
+
+char translateHex(char hex)
+{ // Of a hex digit
+	return (hex >= 'A') ? (hex & 0xdf) - 'A' + 10 : hex - '0';
+}
+
+} // namespace
+
+std::size_t decodeURL(std::string_view encoded, char* decoded)
+{
+	const std::size_t len = encoded.length();
+	std::size_t n = 0;
+	for (std::size_t i = 0; i < len; ++i) {
+		const char c = encoded[i];
+		if (c == '+') {
+			decoded[n++] = ' ';
+		} else if (c == '%' && i + 2 < len && isHexDigit(encoded[i + 1]) && isHexDigit(encoded[i + 2])) {
+			decoded[n++] = static_cast<char>(translateHex(encoded[i + 1]) * 16 + translateHex(encoded[i + 2]));
+			i += 2; // Move past hex code
+		} else { // An ordinary character, or a malformed escape
+			decoded[n++] = c;
+		}
+	}
+	return n;
+}
+
+void CGIViewMap::parse(std::string_view query)
+{
+	std::size_t used = arena_.size();
+	arena_.resize(used + query.length()); // room enough, as decoding never lengthens
+	while (!query.empty()) {
+		const std::string_view::size_type ampersand = query.find('&');
+		const std::string_view field(query.substr(0, ampersand));
+		query.remove_prefix((ampersand == std::string_view::npos) ? query.length() : ampersand + 1);
+		const std::string_view::size_type equalSign = field.find('=');
+		if (equalSign == std::string_view::npos) continue;
+		Slot slot;
+		slot.offset = static_cast<std::uint32_t>(used);
+		slot.nameLength = static_cast<std::uint32_t>(decodeURL(field.substr(0, equalSign), &arena_[used]));
+		used += slot.nameLength;
+		slot.valueLength = static_cast<std::uint32_t>(decodeURL(field.substr(equalSign + 1), &arena_[used]));
+		used += slot.valueLength;
+		slots_.push_back(slot);
+	}
+	arena_.resize(used);
+}
+
+std::optional<std::string_view> CGIViewMap::find(std::string_view name) const
+{ // A linear scan, as forms are small
+	for (auto it = slots_.rbegin(); it != slots_.rend(); ++it) {
+		if (std::string_view(arena_).substr(it->offset, it->nameLength) == name) {
+			return std::string_view(arena_).substr(it->offset + it->nameLength, it->valueLength);
+		}
+	}
+	return std::nullopt;
+}
+
+bool HTTPParser::startsRequest(std::string_view line)
+{
+	return line.compare(0, 5, "GET /") == 0 || line.compare(0, 6, "POST /") == 0 || line.compare(0, 6, "HEAD /") == 0
+		|| line.compare(0, 5, "PUT /") == 0 || line.compare(0, 8, "DELETE /") == 0 || line.compare(0, 9, "OPTIONS /") == 0;
+}
+
+void HTTPParser::reset()
+{
+	state_ = State::requestLine;
+	request_ = Request();
+	line_.clear();
+	headerLength_ = 0;
+	hasContentLength_ = false;
+	errorStatus_ = 0;
+	errorMessage_.clear();
+}
+
+std::size_t HTTPParser::parse(const char* data, const std::size_t length)
+{
+	std::size_t used = 0;
+	while (used < length && (state_ == State::requestLine || state_ == State::headers)) {
+		const char* end = static_cast<const char*>(std::memchr(data + used, '\n', length - used));
+		const std::size_t n = (end ? end - (data + used) : length - used);
+		headerLength_ += n + (end ? 1 : 0);
+		if (headerLength_ > maxHeaderLength) {
+			fail(431, "request headers longer than " + std::to_string(maxHeaderLength) + " bytes");
+			return used + n;
+		}
+		line_.append(data + used, n);
+		used += n;
+		if (!end) break; // the rest of the line is still to come
+		++used;
+		if (!line_.empty() && line_.back() == '\r') line_.pop_back();
+		if (state_ == State::requestLine) {
+			if (!line_.empty()) parseRequestLine(); // else a stray CRLF between requests
+		} else if (line_.empty()) { // the end of the headers
+			state_ = (request_.contentLength > 0) ? State::body : State::done;
+			request_.body.reserve(request_.contentLength);
+		} else {
+			parseHeader();
+		}
+		line_.clear();
+	}
+	if (state_ == State::body && used < length) {
+		const std::size_t n = std::min(length - used, request_.contentLength - request_.body.length());
+		request_.body.append(data + used, n);
+		used += n;
+		if (request_.body.length() == request_.contentLength) state_ = State::done;
+	}
+	return used;
+}
+
+void HTTPParser::parseRequestLine()
+{ // method SP target SP version
+	const std::string::size_type p1 = line_.find(' ');
+	const std::string::size_type p2 = (p1 == std::string::npos) ? std::string::npos : line_.find(' ', p1 + 1);
+	if (p2 == std::string::npos || line_.find(' ', p2 + 1) != std::string::npos) {
+		fail(400, "malformed request line \"" + line_ + "\"");
+		return;
+	}
+	request_.method = line_.substr(0, p1);
+	request_.target = line_.substr(p1 + 1, p2 - p1 - 1);
+	const std::string_view version(std::string_view(line_).substr(p2 + 1));
+	if (version == "HTTP/1.1") {
+		request_.keepAlive = true;
+	} else if (version == "HTTP/1.0") {
+		request_.keepAlive = false;
+	} else {
+		fail(505, "unsupported version \"" + std::string(version) + "\"");
+		return;
+	}
+	if (request_.method != "GET" && request_.method != "POST") {
+		fail(501, "unsupported method " + request_.method);
+		return;
+	}
+	if (request_.target.empty() || request_.target.front() != '/') {
+		fail(400, "malformed target \"" + request_.target + "\"");
+		return;
+	}
+	state_ = State::headers;
+}
+
+void HTTPParser::parseHeader()
+{ // name: value
+	const std::string::size_type colon = line_.find(':');
+	if (colon == std::string::npos || colon == 0) {
+		fail(400, "malformed header \"" + line_ + "\"");
+		return;
+	}
+	const std::string_view name(std::string_view(line_).substr(0, colon));
+	const std::string_view value(trim(std::string_view(line_).substr(colon + 1)));
+	if (equalsIgnoringCase(name, "Content-Length")) {
+		if (value.empty() || value.length() > 9 || !std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+			fail(400, "bad Content-Length \"" + std::string(value) + "\"");
+			return;
+		}
+		const std::size_t contentLength = std::stoul(std::string(value));
+		if (hasContentLength_ && contentLength != request_.contentLength) {
+			fail(400, "conflicting Content-Length headers");
+			return;
+		}
+		if (contentLength > maxBodyLength) {
+			fail(413, "body longer than " + std::to_string(maxBodyLength) + " bytes");
+			return;
+		}
+		request_.contentLength = contentLength;
+		hasContentLength_ = true;
+	} else if (equalsIgnoringCase(name, "Transfer-Encoding")) {
+		fail(501, "unsupported Transfer-Encoding \"" + std::string(value) + "\"");
+	} else if (equalsIgnoringCase(name, "Connection")) { // a comma-separated list of options
+		std::string_view options(value);
+		while (!options.empty()) {
+			const std::string::size_type comma = options.find(',');
+			const std::string_view option(trim(options.substr(0, comma)));
+			if (equalsIgnoringCase(option, "close")) {
+				request_.keepAlive = false;
+			} else if (equalsIgnoringCase(option, "keep-alive")) {
+				request_.keepAlive = true;
+			}
+			options.remove_prefix((comma == std::string_view::npos) ? options.length() : comma + 1);
+		}
+	}
+}
+
+void HTTPParser::fail(const unsigned status, std::string message)
+{
+	state_ = State::failed;
+	errorStatus_ = status;
+	errorMessage_ = std::move(message);
+	request_.keepAlive = false; // the rest of the stream cannot be trusted
+}
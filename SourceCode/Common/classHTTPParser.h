@@ -0,0 +1,129 @@
+// classHTTPParser.h
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// An incremental parser of HTTP/1.1 requests, for the web requests of SocketServer: it is fed the bytes of a
+// connection as they arrive, in pieces of any size, and completes a request once it has its request line, its
+// headers, and Content-Length bytes of body. Only GET and POST are supported, without chunked bodies. After
+// handling a request, reset() prepares for the next one on the same (keep-alive) connection.
+//
+// CGIViewMap holds the fields of a query string or form, decoded into one reused arena, so that a web handler
+// registered as, e.g.,
+//
+//	std::string theFn(const CGIViewMap& fields) { return "Hello " + std::string(fields.value("name")); }
+//	const bool registeredFn = FunctionRegistry<std::string, const CGIViewMap&>::Instance().Register("myFn", theFn);
+//
+// reads them as string_views, without a std::map of copies being built for each request.
+
+#ifndef CLASS_HTTP_PARSER_H
+#define CLASS_HTTP_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+std::size_t decodeURL(std::string_view encoded, char* decoded);
+	// Decodes '+' and %XX escapes into decoded, which may be encoded.data(), as decoding never lengthens the text;
+	// returns the decoded length. A '%' that is not followed by two hex digits, e.g. at the end, is kept as is.
+
+class CGIViewMap {
+public:
+	typedef std::pair<std::string_view, std::string_view> Field; // (name, value)
+private:
+	struct Slot {
+		std::uint32_t offset; // of the name in arena_, followed by the value
+		std::uint32_t nameLength;
+		std::uint32_t valueLength;
+	};
+	std::string arena_; // the decoded names and values; its capacity is kept by clear()
+	std::vector<Slot> slots_; // in order of appearance
+public:
+	void parse(std::string_view query); // adds the fields of name=value&name=value...; one without '=' is skipped
+	void clear() { arena_.clear(); slots_.clear(); }
+
+	std::optional<std::string_view> find(std::string_view name) const; // of the last field with that name
+	std::string_view value(std::string_view name) const { return find(name).value_or(std::string_view()); }
+	bool empty() const { return slots_.empty(); }
+	std::size_t size() const { return slots_.size(); }
+	Field operator[](std::size_t i) const { // valid until the next parse() or clear()
+		const Slot& s = slots_[i];
+		return Field(std::string_view(arena_).substr(s.offset, s.nameLength), std::string_view(arena_).substr(s.offset + s.nameLength, s.valueLength));
+	}
+};
+
+class HTTPParser {
+public:
+	static constexpr std::size_t maxHeaderLength = 16384; // the request line and the headers, together
+	static constexpr std::size_t maxBodyLength = 1 << 20;
+
+	struct Request {
+		std::string method; // GET or POST
+		std::string target; // e.g. /status?WebCommand=Stats
+		std::string body;
+		std::size_t contentLength = 0;
+		bool keepAlive = true; // the default for HTTP/1.1, unless "Connection: close"; for HTTP/1.0, only with "Connection: keep-alive"
+
+		std::string_view query() const { // of the target, without the '?'
+			const std::string::size_type p = target.find('?');
+			return (p == std::string::npos) ? std::string_view() : std::string_view(target).substr(p + 1);
+		}
+	};
+
+	static bool startsRequest(std::string_view line); // e.g. "GET / HTTP/1.1", rather than a command__+__argument line
+
+	HTTPParser() { reset(); }
+	std::size_t parse(const char* data, std::size_t length); // returns the number of bytes used, up to the end of the request
+	bool done() const { return state_ == State::done; }
+	bool failed() const { return state_ == State::failed; }
+	const Request& request() const { return request_; } // once done()
+	unsigned errorStatus() const { return errorStatus_; } // once failed(), e.g. 400
+	const std::string& errorMessage() const { return errorMessage_; }
+	void reset();
+private:
+	enum class State { requestLine, headers, body, done, failed };
+
+	State state_;
+	Request request_;
+	std::string line_; // being received
+	std::size_t headerLength_;
+	bool hasContentLength_;
+	unsigned errorStatus_;
+	std::string errorMessage_;
+
+	void parseRequestLine();
+	void parseHeader();
+	void fail(unsigned status, std::string message);
+};
+
+#endif
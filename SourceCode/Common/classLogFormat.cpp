@@ -0,0 +1,107 @@
+// classLogFormat.cpp
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "classLogFormat.h"
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+	std::atomic<std::uint32_t> nextFormatID(0);
+
+	void appendDecodedArgument(std::string& text, const char*& p, const char* end)
+	{
+		const char tag = readRaw<char>(p, end);
+		switch (tag) {
+			case LogFormat::_int_:
+				text += std::to_string(readRaw<std::int64_t>(p, end));
+				break;
+			case LogFormat::_uint_:
+				text += std::to_string(readRaw<std::uint64_t>(p, end));
+				break;
+			case LogFormat::_double_: {
+				std::ostringstream ost;
+				ost << readRaw<double>(p, end);
+				text += ost.str();
+				break;
+			}
+			case LogFormat::_bool_:
+				text += readRaw<std::uint8_t>(p, end) ? "true" : "false";
+				break;
+			case LogFormat::_string_: {
+				const std::uint32_t length = readRaw<std::uint32_t>(p, end);
+				if (static_cast<std::size_t>(end - p) < length) {
+					throw std::runtime_error("expandLogFormat(): truncated string argument");
+				}
+				text.append(p, length);
+				p += length;
+				break;
+			}
+			default:
+				throw std::runtime_error(std::string("expandLogFormat(): unknown argument type tag ") + tag);
+		}
+	}
+}
+
+LogFormat::LogFormat(const std::string& format) :
+	format_(format),
+	id_(nextFormatID++)
+{ }
+
+const LogFormat& LogFormat::plainText()
+{
+	static const LogFormat textFormat("{}");
+	return textFormat;
+}
+
+std::string expandLogFormat(const std::string& format, std::string_view encodedArguments)
+{
+	std::string text;
+	text.reserve(format.length() + encodedArguments.length());
+	const char* p = encodedArguments.data();
+	const char* const end = p + encodedArguments.length();
+	std::string::size_type from = 0;
+	for (std::string::size_type placeholder = format.find("{}"); placeholder != std::string::npos; placeholder = format.find("{}", from)) {
+		text.append(format, from, placeholder - from);
+		from = placeholder + 2;
+		if (p == end) { // fewer arguments than placeholders: leave the placeholder as is
+			text += "{}";
+		} else {
+			appendDecodedArgument(text, p, end);
+		}
+	}
+	text.append(format, from, std::string::npos);
+	while (p != end) {
+		text.push_back(' ');
+		appendDecodedArgument(text, p, end);
+	}
+	return text;
+}
@@ -0,0 +1,122 @@
+// classLogFormat.h
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Deferred formatting of log entries: a call site registers its format string once, and logs only the raw
+// arguments, which are encoded into a compact binary form. The text is rebuilt later (if ever) by
+// expandLogFormat(), e.g. by the ngilogdecode tool reading a binary run log written by Logger.
+//
+// Binary run log layout (native byte order):
+//	file header:	"NGIBLOG1", then u32 length + the constant prefix tail (tab, host name, tab, user name, tab, data ID, tab, program name, tab)
+//	'F' record:		u32 format ID, u32 length, format string; precedes the first use of each format ID in the file
+//	'T' record:		i64 seconds since the epoch, u8 length, formatted local date, tab, time and zone; applies to subsequent 'R' records
+//	'R' record:		u32 format ID, u8 log level, u32 length, encoded arguments
+// Encoded arguments are a sequence of a one-character type tag followed by the value:
+//	'i' i64, 'u' u64, 'd' double, 'b' u8 (bool), 's' u32 length + characters
+
+#ifndef CLASS_LOG_FORMAT_H
+#define CLASS_LOG_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+class LogFormat {
+private:
+	std::string format_; // "{}" marks where each argument goes
+	std::uint32_t id_;
+public:
+	static constexpr char fileMagic[] = "NGIBLOG1"; // 8 characters, without the terminating '\0'
+	enum : char { _definitionRecord_ = 'F', _timestampRecord_ = 'T', _logRecord_ = 'R' };
+	enum : char { _int_ = 'i', _uint_ = 'u', _double_ = 'd', _bool_ = 'b', _string_ = 's' };
+
+	explicit LogFormat(const std::string& format); // assigns the next unused ID
+	LogFormat(const LogFormat&) = delete;
+	LogFormat& operator=(const LogFormat&) = delete;
+
+	const std::string& itsFormat() const { return format_; }
+	std::uint32_t itsID() const { return id_; }
+	static const LogFormat& plainText(); // "{}", used for text entries within a binary run log
+		// Call sites should hold their LogFormat in a function-local static, e.g.
+		// static const LogFormat accepted("SocketServer accepted a connection from {} on port {}");
+
+	template<typename T> static void appendRaw(std::string& buffer, const T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "appendRaw(): type must be trivially copyable");
+		buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+	static void appendString(std::string& buffer, std::string_view s) {
+		buffer.push_back(_string_);
+		appendRaw(buffer, static_cast<std::uint32_t>(s.length()));
+		buffer.append(s.data(), s.length());
+	}
+
+	template<typename T> static void encodeArgument(std::string& buffer, const T& value) {
+		if constexpr (std::is_same<T, bool>::value) {
+			buffer.push_back(_bool_);
+			appendRaw(buffer, static_cast<std::uint8_t>(value));
+		} else if constexpr (std::is_same<T, char>::value) {
+			appendString(buffer, std::string_view(&value, 1));
+		} else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+			buffer.push_back(_int_);
+			appendRaw(buffer, static_cast<std::int64_t>(value));
+		} else if constexpr (std::is_integral<T>::value) {
+			buffer.push_back(_uint_);
+			appendRaw(buffer, static_cast<std::uint64_t>(value));
+		} else if constexpr (std::is_floating_point<T>::value) {
+			buffer.push_back(_double_);
+			appendRaw(buffer, static_cast<double>(value));
+		} else {
+			static_assert(std::is_convertible<const T&, std::string_view>::value, "encodeArgument(): unsupported argument type");
+			appendString(buffer, std::string_view(value));
+		}
+	}
+	template<typename... Args> static void encodeArguments(std::string& buffer, const Args&... args) {
+		(encodeArgument(buffer, args), ...);
+	}
+};
+
+template<typename T> T readRaw(const char*& p, const char* end)
+{ // Advances p; throws if the data are truncated
+	T value;
+	if (static_cast<std::size_t>(end - p) < sizeof(value)) {
+		throw std::runtime_error("readRaw(): truncated binary log data");
+	}
+	std::memcpy(&value, p, sizeof(value));
+	p += sizeof(value);
+	return value;
+}
+
+std::string expandLogFormat(const std::string& format, std::string_view encodedArguments);
+	// Substitutes each "{}" with the next encoded argument; surplus arguments are appended, separated by spaces
+
+#endif
@@ -0,0 +1,184 @@
+// classLogQuery.cpp
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "classLogQuery.h"
+#include "ngiAlgorithms.h"
+#include "ngiFileUtilities.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+	bool parseNumber(std::string_view text, int* value)
+	{
+		return !text.empty() && std::from_chars(text.data(), text.data() + text.length(), *value).ptr == text.data() + text.length();
+	}
+
+	std::time_t entryTime(std::string_view date, std::string_view timeAndZone)
+	{ // E.g. 2021-12-31 and 16:00:00 EST, as written by Logger; -1 if malformed. The zone tells repeated local times
+		// apart when daylight saving time ends, so that entries can be compared as seconds since the epoch.
+		std::tm localTime{};
+		if (date.length() != 10 || timeAndZone.length() < 8 || !parseNumber(date.substr(0, 4), &localTime.tm_year) || !parseNumber(date.substr(5, 2), &localTime.tm_mon) || !parseNumber(date.substr(8, 2), &localTime.tm_mday)
+				|| !parseNumber(timeAndZone.substr(0, 2), &localTime.tm_hour) || !parseNumber(timeAndZone.substr(3, 2), &localTime.tm_min) || !parseNumber(timeAndZone.substr(6, 2), &localTime.tm_sec)) {
+			return -1;
+		}
+		localTime.tm_year -= 1900;
+		localTime.tm_mon -= 1;
+		const std::string_view zone(timeAndZone.substr(std::min<std::size_t>(9, timeAndZone.length())));
+		localTime.tm_isdst = (daylight && zone == tzname[1]) ? 1 : (zone == tzname[0] ? 0 : -1);
+		return std::mktime(&localTime);
+	}
+
+	bool fieldMatches(const std::string& wanted, std::string_view field)
+	{
+		return wanted.empty() || field == wanted;
+	}
+}
+
+LogQuery::LogQuery(const std::string& logFileName) :
+	logFileName_(logFileName),
+	data_(nullptr),
+	size_(0)
+{
+	const int fd = open(logFileName_.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw std::runtime_error("LogQuery::LogQuery(), cannot open " + logFileName_ + " (" + std::strerror(errno) + ')');
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("LogQuery::LogQuery(), cannot stat " + logFileName_);
+	}
+	size_ = info.st_size;
+	if (size_ > 0) {
+		void* mapped = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("LogQuery::LogQuery(), cannot mmap " + logFileName_ + " (" + std::strerror(errno) + ')');
+		}
+		data_ = static_cast<const char*>(mapped);
+		madvise(mapped, size_, MADV_RANDOM); // only the queried ranges get paged in
+	}
+	close(fd); // the mapping remains valid
+	const std::string indexName(Logger::indexFileName(logFileName_));
+	if (fs::exists(indexName)) {
+		const std::string index(readFileIntoString(indexName));
+		checkpoints_.resize(index.length() / sizeof(Logger::IndexCheckpoint));
+		std::memcpy(checkpoints_.data(), index.data(), checkpoints_.size() * sizeof(Logger::IndexCheckpoint));
+		// Ignore checkpoints beyond the mapped size, e.g. written after we mapped the log:
+		checkpoints_.erase(std::find_if(checkpoints_.begin(), checkpoints_.end(), [this](const Logger::IndexCheckpoint& c) { return c.offset > size_; }), checkpoints_.end());
+		// Logger writes nondecreasing times, but indexes from older versions may not be; the binary search needs them sorted
+		for (std::size_t i = 1; i < checkpoints_.size(); ++i) {
+			checkpoints_[i].second = std::max(checkpoints_[i].second, checkpoints_[i - 1].second);
+		}
+	}
+}
+
+LogQuery::~LogQuery()
+{
+	if (data_) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+}
+
+void LogQuery::forEach(const Filter& filter, const std::function<void(std::string_view line)>& f) const
+{
+	if (!data_ || filter.from > filter.to) return;
+	// Binary search for the byte range, widened by slackSeconds at both ends:
+	const std::int64_t startSecond = static_cast<std::int64_t>(filter.from) - filter.slackSeconds;
+	const std::int64_t endSecond = (filter.to > std::numeric_limits<std::time_t>::max() - filter.slackSeconds) ? std::numeric_limits<std::int64_t>::max() : static_cast<std::int64_t>(filter.to) + filter.slackSeconds;
+	const auto first = std::partition_point(checkpoints_.begin(), checkpoints_.end(), [startSecond](const Logger::IndexCheckpoint& c) { return c.second < startSecond; });
+	const auto last = std::partition_point(first, checkpoints_.end(), [endSecond](const Logger::IndexCheckpoint& c) { return c.second <= endSecond; });
+	std::size_t begin = (first == checkpoints_.begin()) ? 0 : (first - 1)->offset;
+	const std::size_t end = (last == checkpoints_.end()) ? size_ : last->offset;
+	// Checkpoints are at line starts, but be defensive:
+	while (begin > 0 && begin < end && data_[begin - 1] != '\n') ++begin;
+
+	tzset(); // for tzname, in entryTime()
+	std::string_view lastTimestamp; // consecutive entries mostly share a timestamp, so each is only converted once
+	std::time_t lastTime = -1;
+	std::string_view range(data_ + begin, end - begin);
+	while (!range.empty()) {
+		const std::string_view::size_type eol = range.find('\n');
+		const std::string_view line(range.substr(0, eol));
+		range.remove_prefix(eol == std::string_view::npos ? range.length() : eol + 1);
+		// Fields: date, time & zone, host name, user name, data ID, program name, comment
+		std::string_view fields[7];
+		std::string_view rest(line);
+		int numFields = 0;
+		for (; numFields < 6; ++numFields) {
+			const std::string_view::size_type tab = rest.find('\t');
+			if (tab == std::string_view::npos) break;
+			fields[numFields] = rest.substr(0, tab);
+			rest.remove_prefix(tab + 1);
+		}
+		if (numFields < 6) continue; // not a log entry
+		fields[6] = rest;
+		const std::string_view timestamp(line.substr(0, fields[0].length() + 1 + fields[1].length()));
+		if (timestamp != lastTimestamp) {
+			lastTimestamp = timestamp;
+			lastTime = entryTime(fields[0], fields[1]);
+		}
+		if (lastTime < 0 || lastTime < filter.from || lastTime > filter.to) continue;
+		if (!fieldMatches(filter.hostName, fields[2]) || !fieldMatches(filter.userName, fields[3]) || !fieldMatches(filter.dataID, fields[4]) || !fieldMatches(filter.programName, fields[5])) continue;
+		if (filter.minLevel > Logger::_info_) {
+			const int level = beginsWith(fields[6], "***ERROR***") ? Logger::_error_ : (beginsWith(fields[6], "**WARNING**") ? Logger::_warn_ : Logger::_info_);
+			if (level < filter.minLevel) continue;
+		}
+		f(line);
+	}
+}
+
+std::vector<std::string> LogQuery::find(const Filter& filter) const
+{
+	std::vector<std::string> lines;
+	forEach(filter, [&lines](std::string_view line) { lines.emplace_back(line); });
+	return lines;
+}
+
+std::time_t LogQuery::parseLocalTime(const std::string& dateTime)
+{
+	std::tm localTime{};
+	if (std::sscanf(dateTime.c_str(), "%d-%d-%d %d:%d:%d", &localTime.tm_year, &localTime.tm_mon, &localTime.tm_mday, &localTime.tm_hour, &localTime.tm_min, &localTime.tm_sec) != 6) {
+		throw std::runtime_error("LogQuery::parseLocalTime(), expected YYYY-MM-DD HH:MM:SS but found " + dateTime);
+	}
+	localTime.tm_year -= 1900;
+	localTime.tm_mon -= 1;
+	localTime.tm_isdst = -1; // let mktime() work out whether daylight saving time applies
+	return std::mktime(&localTime);
+}
@@ -0,0 +1,78 @@
+// classLogQuery.h
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Time-range queries over a master log, using the sidecar index of (time, byte offset) checkpoints that Logger
+// maintains after Logger::enableMasterLogIndex(). The log is memory-mapped, the index is binary-searched for
+// the byte range covering the time window, and only the lines within that range are examined.
+
+#ifndef CLASS_LOG_QUERY_H
+#define CLASS_LOG_QUERY_H
+
+#include "classLogger.h"
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class LogQuery {
+private:
+	std::string logFileName_;
+	const char* data_; // memory-mapped log, or nullptr if the log is empty
+	std::size_t size_;
+	std::vector<Logger::IndexCheckpoint> checkpoints_; // in the order written, i.e. by increasing offset
+public:
+	struct Filter {
+		std::time_t from = 0; // inclusive
+		std::time_t to = std::numeric_limits<std::time_t>::max(); // inclusive
+		std::string hostName; // an empty string matches everything, here and below
+		std::string userName;
+		std::string dataID;
+		std::string programName;
+		int minLevel = Logger::_debug_; // _warn_ and _error_ are recognized by the comment's **WARNING** or ***ERROR*** prefix
+		int slackSeconds = 5; // allowance for entries written slightly out of time order, e.g. by other processes
+	};
+
+	explicit LogQuery(const std::string& logFileName);
+	LogQuery(const LogQuery&) = delete;
+	LogQuery& operator=(const LogQuery&) = delete;
+	~LogQuery();
+
+	std::size_t numCheckpoints() const { return checkpoints_.size(); }
+	void forEach(const Filter& filter, const std::function<void(std::string_view line)>& f) const;
+		// f receives each matching line, without its '\n', in file order
+	std::vector<std::string> find(const Filter& filter) const;
+
+	static std::time_t parseLocalTime(const std::string& dateTime); // "YYYY-MM-DD HH:MM:SS", as in the log
+};
+
+#endif
@@ -1,8 +1,8 @@
 // classLogger.cpp
-// Version 2021.12.25
+// Version 2026.10.16
 
 /*
-Copyright (c) 2013-2021, NeuroGadgets Inc.
+Copyright (c) 2013-2026, NeuroGadgets Inc.
 Author: Robert L. Charlebois
 All rights reserved.
 
@@ -32,14 +32,337 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "classLogger.h"
 #include "ngiAlgorithms.h"
 #include "ngiFileUtilities.h"
+#include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <ctime>
-#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <sstream>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
 #include <pwd.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+namespace {
+	int openLogForAppending(const std::string& fileName, const int access = O_WRONLY)
+	{ // Aborts on failure, as omitting log entries is not an option
+		const int fd = open(fileName.c_str(), access | O_APPEND | O_CREAT | O_CLOEXEC, 0666); // subject to umask, as with std::ofstream
+		if (fd < 0) {
+			std::cerr << "Cannot open " << fileName << "... aborting." << std::endl;
+			std::exit(1);
+		}
+		return fd;
+	}
+
+	int gzipFile(const std::string& fileName)
+	{ // Returns gzip's exit status; the file name is passed as an argument, never through a shell
+		const char* const argv[] = { "gzip", "-f", "--", fileName.c_str(), nullptr };
+		posix_spawn_file_actions_t actions; // gzip's own complaints are dropped, as the file may have been pruned meanwhile
+		posix_spawn_file_actions_init(&actions);
+		posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+		pid_t pid;
+		const int error = posix_spawnp(&pid, "gzip", &actions, nullptr, const_cast<char* const*>(argv), environ);
+		posix_spawn_file_actions_destroy(&actions);
+		if (error) {
+			throw std::runtime_error("cannot run gzip (" + std::string(std::strerror(error)) + ')');
+		}
+		int status;
+		while (waitpid(pid, &status, 0) < 0) {
+			if (errno != EINTR) {
+				throw std::runtime_error("cannot wait for gzip (" + std::string(std::strerror(errno)) + ')');
+			}
+		}
+		return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+	}
+
+	void writeAll(const int fd, std::vector<iovec>& iov, const std::string& fileName)
+	{ // Gathered write that copes with partial writes and with more than IOV_MAX buffers
+		std::size_t first = 0;
+		while (first < iov.size()) {
+			const int count = static_cast<int>(std::min<std::size_t>(iov.size() - first, IOV_MAX));
+			ssize_t written = writev(fd, &iov[first], count);
+			if (written < 0) {
+				if (errno == EINTR) continue;
+				std::cerr << "Cannot write to " << fileName << " (" << std::strerror(errno) << ")... aborting." << std::endl;
+				std::exit(1);
+			}
+			while (first < iov.size() && static_cast<std::size_t>(written) >= iov[first].iov_len) {
+				written -= iov[first].iov_len;
+				++first;
+			}
+			if (written > 0) { // partial write within iov[first]
+				iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+				iov[first].iov_len -= written;
+			}
+		}
+	}
+
+	inline iovec toIovec(const std::string& s)
+	{
+		return iovec{const_cast<char*>(s.data()), s.length()};
+	}
+
+	const std::string newline("\n");
+	const std::string theRunLogHeader("Date\tTime\tHost Name\tUser Name\tData ID\tProgram Name\tComment\n");
+	const std::string noMasterLockWarning(" **WARNING** Entry may not have been logged in master logfile");
+
+	struct TimestampCache {
+		std::time_t second = -1;
+		std::size_t length = 0;
+		char text[64]; // e.g. 2021-12-31 [tab] 16:00:00 EST
+	};
+
+	inline char* formatDigits(char* p, int value, int numDigits)
+	{ // Zero-padded, most significant digit first
+		for (char* q = p + numDigits; q != p; value /= 10) {
+			*--q = static_cast<char>('0' + value % 10);
+		}
+		return p + numDigits;
+	}
+
+	const TimestampCache& localTimestamp(const std::time_t currentTime)
+	{ // Equivalent to std::put_time(..., "%Y-%m-%d%t%T %Z"), but only reformatted when the second changes
+		thread_local TimestampCache cache;
+		if (currentTime != cache.second) {
+			std::tm localTime;
+			localtime_r(&currentTime, &localTime);
+			char* p = cache.text;
+			p = formatDigits(p, localTime.tm_year + 1900, 4);
+			*p++ = '-';
+			p = formatDigits(p, localTime.tm_mon + 1, 2);
+			*p++ = '-';
+			p = formatDigits(p, localTime.tm_mday, 2);
+			*p++ = '\t';
+			p = formatDigits(p, localTime.tm_hour, 2);
+			*p++ = ':';
+			p = formatDigits(p, localTime.tm_min, 2);
+			*p++ = ':';
+			p = formatDigits(p, localTime.tm_sec, 2);
+			*p++ = ' ';
+			const char* zone = localTime.tm_zone ? localTime.tm_zone : "";
+			char* const end = cache.text + sizeof(cache.text);
+			while (*zone && p != end) {
+				*p++ = *zone++;
+			}
+			cache.length = p - cache.text;
+			cache.second = currentTime;
+		}
+		return cache;
+	}
+}
+
+struct Logger::CrashRing {
+	// A deferred entry is kept raw, on a line of its own that starts with _deferredRecord_: the escaped timestamp
+	// (u8 length + text), LogFormat pointer and encoded arguments. dump() formats it.
+	enum : char { _deferredRecord_ = '\x1e', _escape_ = '\x1b' }; // _escape_ 'n' stands for '\n', _escape_ 'e' for _escape_
+	static constexpr std::size_t maxRecordLength = 4096; // of a deferred entry, unescaped; longer ones are formatted when logged
+	char* data; // anonymous mapping, so that appending costs no more than a memcpy()
+	std::size_t size;
+	std::atomic<std::uint64_t> end; // bytes appended so far; the ring holds the last size of them
+	char dumpFileName[PATH_MAX]; // preformatted, as the signal handler cannot allocate
+	const std::string* prefixTail; // the Logger's, for deferred entries
+	struct sigaction previousSegvAction;
+	struct sigaction previousAbortAction;
+	char record[maxRecordLength]; // dump() works in these, as the signal handler cannot allocate
+	char out[4096];
+	std::size_t outLength;
+
+	void append(const char* text, std::size_t length) {
+		if (length > size) { // keep the tail
+			text += length - size;
+			length = size;
+		}
+		// Concurrent writers reserve disjoint ranges; an entry is only overwritten once the ring wraps around
+		const std::size_t offset = end.fetch_add(length, std::memory_order_relaxed) % size;
+		const std::size_t firstPart = std::min(length, size - offset);
+		std::memcpy(data + offset, text, firstPart);
+		std::memcpy(data, text + firstPart, length - firstPart);
+	}
+
+	static void appendEscaped(std::string& line, const char* p, std::size_t length) {
+		for (const char* const end = p + length; p != end; ++p) {
+			if (*p == '\n') {
+				line.push_back(_escape_);
+				line.push_back('n');
+			} else if (*p == _escape_) {
+				line.push_back(_escape_);
+				line.push_back('e');
+			} else {
+				line.push_back(*p);
+			}
+		}
+	}
+
+	// The rest is async-signal-safe: only open(), write(), close(), and formatting without allocation
+	static void writeRange(const int fd, const char* p, std::size_t length) {
+		while (length > 0) {
+			const ssize_t written = write(fd, p, length);
+			if (written < 0) {
+				if (errno == EINTR) continue;
+				return;
+			}
+			p += written;
+			length -= written;
+		}
+	}
+	void put(const int fd, const char* p, std::size_t length) {
+		while (length > 0) {
+			if (outLength == sizeof(out)) {
+				writeRange(fd, out, outLength);
+				outLength = 0;
+			}
+			const std::size_t n = std::min(length, sizeof(out) - outLength);
+			std::memcpy(out + outLength, p, n);
+			outLength += n;
+			p += n;
+			length -= n;
+		}
+	}
+	bool putArgument(const int fd, const char*& p, const char* end) { // false if the encoded arguments are truncated
+		char number[32];
+		std::to_chars_result converted{number, std::errc()};
+		auto fits = [&p, end](std::size_t length) { return static_cast<std::size_t>(end - p) >= length; };
+		const char tag = *p++;
+		switch (tag) {
+			case LogFormat::_int_:
+			case LogFormat::_uint_:
+			case LogFormat::_double_: {
+				if (!fits(8)) return false;
+				if (tag == LogFormat::_int_) {
+					std::int64_t value;
+					std::memcpy(&value, p, sizeof(value));
+					converted = std::to_chars(number, number + sizeof(number), value);
+				} else if (tag == LogFormat::_uint_) {
+					std::uint64_t value;
+					std::memcpy(&value, p, sizeof(value));
+					converted = std::to_chars(number, number + sizeof(number), value);
+				} else {
+					double value;
+					std::memcpy(&value, p, sizeof(value));
+					converted = std::to_chars(number, number + sizeof(number), value, std::chars_format::general, 6); // as std::ostream
+				}
+				p += 8;
+				put(fd, number, converted.ptr - number);
+				return true;
+			}
+			case LogFormat::_bool_:
+				if (!fits(1)) return false;
+				put(fd, *p ? "true" : "false", *p ? 4 : 5);
+				++p;
+				return true;
+			case LogFormat::_string_: {
+				std::uint32_t length;
+				if (!fits(sizeof(length))) return false;
+				std::memcpy(&length, p, sizeof(length));
+				p += sizeof(length);
+				if (!fits(length)) return false;
+				put(fd, p, length);
+				p += length;
+				return true;
+			}
+			default:
+				return false;
+		}
+	}
+	void putRecord(const int fd, const std::size_t recordLength) { // expands a deferred entry, as expandLogFormat() would
+		const char* p = record;
+		const char* const end = record + recordLength;
+		const LogFormat* format;
+		if (recordLength < 1 || recordLength < 1 + static_cast<std::uint8_t>(*p) + sizeof(format)) return; // truncated
+		const std::size_t timestampLength = static_cast<std::uint8_t>(*p++);
+		put(fd, p, timestampLength);
+		p += timestampLength;
+		std::memcpy(&format, p, sizeof(format));
+		p += sizeof(format);
+		put(fd, prefixTail->data(), prefixTail->length());
+		const std::string& text = format->itsFormat();
+		std::size_t from = 0;
+		bool complete = true;
+		for (std::size_t placeholder = text.find("{}"); placeholder != std::string::npos; placeholder = text.find("{}", from)) {
+			put(fd, text.data() + from, placeholder - from);
+			from = placeholder + 2;
+			if (p == end || !complete) {
+				put(fd, "{}", 2);
+			} else {
+				complete = putArgument(fd, p, end);
+			}
+		}
+		put(fd, text.data() + from, text.length() - from);
+		while (complete && p != end) {
+			put(fd, " ", 1);
+			complete = putArgument(fd, p, end);
+		}
+		put(fd, "\n", 1);
+	}
+
+	void dump() {
+		const int fd = open(dumpFileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+		if (fd < 0) return;
+		const std::uint64_t numBytes = end.load(std::memory_order_relaxed);
+		std::size_t begin = 0;
+		std::size_t length = numBytes;
+		if (numBytes > size) { // Oldest first, starting after the first newline, as the oldest entry is partly overwritten
+			const std::size_t oldest = numBytes % size;
+			std::size_t skipped = 0;
+			while (skipped < size && data[(oldest + skipped) % size] != '\n') ++skipped;
+			begin = (oldest + skipped + 1) % size;
+			length = (skipped < size) ? size - skipped - 1 : 0;
+		}
+		outLength = 0;
+		bool atLineStart = true;
+		bool inRecord = false;
+		bool escaped = false;
+		std::size_t recordLength = 0;
+		for (std::size_t i = 0; i < length; ++i) {
+			const char c = data[(begin + i) % size];
+			if (inRecord) { // deferred entries are unescaped into record, then formatted
+				if (c == '\n') {
+					putRecord(fd, recordLength);
+					inRecord = false;
+					atLineStart = true;
+				} else if (escaped || c != _escape_) {
+					if (recordLength < sizeof(record)) record[recordLength++] = escaped ? (c == 'n' ? '\n' : static_cast<char>(_escape_)) : c;
+					escaped = false;
+				} else {
+					escaped = true;
+				}
+			} else if (atLineStart && c == _deferredRecord_) {
+				inRecord = true;
+				escaped = false;
+				recordLength = 0;
+			} else {
+				put(fd, &c, 1);
+				atLineStart = (c == '\n');
+			}
+		}
+		writeRange(fd, out, outLength);
+		close(fd);
+	}
+};
+
+std::atomic<Logger::CrashRing*> Logger::activeCrashRing_(nullptr);
+
+void Logger::crashSignalHandler(const int signalNumber)
+{
+	CrashRing* ring = activeCrashRing_.exchange(nullptr); // dumped once, even if several threads crash
+	if (!ring) return; // another thread is dumping, and will re-raise its signal
+	ring->dump();
+	sigaction(SIGSEGV, &ring->previousSegvAction, nullptr);
+	sigaction(SIGABRT, &ring->previousAbortAction, nullptr);
+	raise(signalNumber); // blocked until we return, then handled as it would have been without the ring
+}
 
 Logger::Logger(const std::string& masterLogfileName, const std::string& runLogfileName, const std::string& dataID, const std::string& commandLine, const std::string& specifiedUser) :
 	startTimePoint_(std::chrono::system_clock::now()),
@@ -49,11 +372,35 @@ Logger::Logger(const std::string& masterLogfileName, const std::string& runLogfi
 	theCommandLine_(commandLine),
 	programName_(commandLine.substr(0, commandLine.find(' '))),
 	dataID_(dataID),
+	masterLogDescriptor_(-1),
+	runLogDescriptor_(-1),
+	indexDescriptor_(-1),
+	indexIntervalBytes_(0),
+	binaryRunLogDescriptor_(-1),
+	lastBinarySecond_(-1),
 	numErrorsLogged_(0),
 	numWarningsLogged_(0),
+	numLinesLogged_(),
+	numLinesDropped_(0),
+	numLinesSuppressed_(0),
 	logLevel_(_info_), // default
 	notDoneWritingLog_(true),
-	firstWriteToRunLog_(false)
+	firstWriteToRunLog_(false),
+	queueCapacity_(0),
+	numEnqueued_(0),
+	numWritten_(0),
+	numDropped_(0),
+	overflowPolicy_(Overflow::_block_),
+	writingAsynchronously_(false),
+	stopWriter_(false),
+	lastLevel_(_debug_),
+	lastAlsoToMasterLog_(false),
+	numRepeats_(0),
+	suppressRepeats_(false),
+	rotating_(false),
+	stopCompression_(false),
+	crashRing_(nullptr),
+	crashRingLevel_(_numLogLevels_)
 {
 	passwd* pwdReal = getpwuid(getuid());
 	if (pwdReal) {
@@ -83,8 +430,11 @@ Logger::Logger(const std::string& masterLogfileName, const std::string& runLogfi
 	char theHostName[256];
 	gethostname(theHostName, sizeof(theHostName)); // from unistd.h
 	hostName_ = theHostName;
+	prefixTail_ = '\t' + hostName_ + '\t' + userName_ + '\t' + dataID_ + '\t' + programName_ + '\t';
+	masterLogDescriptor_ = openLogForAppending(masterLogfileName_);
 	if (!runLogfileName.empty()) {
 		firstWriteToRunLog_ = !fs::exists(runLogfileName_);
+		runLogDescriptor_ = openLogForAppending(runLogfileName_);
 	}
 	addToLog("Launched " + commandLine);
 }
@@ -95,52 +445,291 @@ Logger::~Logger()
 		warningToLog("Logger object destroyed without implicitly or explicitly calling Logger::endLog()");
 		endLog(1);
 	}
+	stopBackgroundCompression();
+	if (crashRing_) {
+		CrashRing* ring = crashRing_;
+		if (activeCrashRing_.compare_exchange_strong(ring, nullptr)) {
+			sigaction(SIGSEGV, &crashRing_->previousSegvAction, nullptr);
+			sigaction(SIGABRT, &crashRing_->previousAbortAction, nullptr);
+		}
+		munmap(crashRing_->data, crashRing_->size);
+		delete crashRing_;
+	}
+	if (binaryRunLogDescriptor_ >= 0) close(binaryRunLogDescriptor_);
+	if (indexDescriptor_ >= 0) close(indexDescriptor_);
+	if (runLogDescriptor_ >= 0) close(runLogDescriptor_);
+	if (masterLogDescriptor_ >= 0) close(masterLogDescriptor_);
 }
 
 void Logger::addToLog(const std::string& comment, const bool alsoToMasterLog, const int level)
 {
-	if (level < logLevel_) return;
+	addToLogUnlessRepeated(comment, alsoToMasterLog, level);
+}
+
+bool Logger::addToLogUnlessRepeated(const std::string& comment, const bool alsoToMasterLog, const int level)
+{
+	if (!isRecorded(level)) return true;
 	assert(notDoneWritingLog_);
-	std::lock_guard<std::mutex> lock(myMutex_);
+	assert(level < _numLogLevels_);
+	if (level >= crashRingLevel_.load(std::memory_order_acquire)) {
+		appendToCrashRing(comment);
+		if (level < getLogLevel()) return true; // the crash ring only
+	}
+	if (!suppressRepeats_.load(std::memory_order_relaxed)) {
+		writeLine(comment, alsoToMasterLog, level);
+		return true;
+	}
+	bool repeated;
+	std::uint64_t numRepeats = 0; // to report, before this entry if it is a different one
+	int repeatLevel = level;
+	bool repeatAlsoToMasterLog = alsoToMasterLog;
+	{ // Only the comparison is locked, so that producers do not wait for each other's writes
+		std::lock_guard<std::mutex> lock(suppressionMutex_);
+		repeated = (comment == lastComment_ && level == lastLevel_ && alsoToMasterLog == lastAlsoToMasterLog_);
+		if (repeated) {
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (numRepeats_++ == 0) {
+				firstRepeat_ = now;
+			} else if (now - firstRepeat_ >= std::chrono::seconds(30)) { // arbitrary, as in syslog
+				std::swap(numRepeats, numRepeats_); // so that a long run of repeats still shows up in the log
+			}
+			numLinesSuppressed_.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			std::swap(numRepeats, numRepeats_);
+			repeatLevel = lastLevel_;
+			repeatAlsoToMasterLog = lastAlsoToMasterLog_;
+			lastComment_ = comment;
+			lastLevel_ = level;
+			lastAlsoToMasterLog_ = alsoToMasterLog;
+		}
+	}
+	writeRepeats(numRepeats, repeatAlsoToMasterLog, repeatLevel);
+	if (repeated) return false;
+	writeLine(comment, alsoToMasterLog, level);
+	return true;
+}
+
+void Logger::reportRepeats()
+{
+	std::uint64_t numRepeats = 0;
+	int level;
+	bool alsoToMasterLog;
+	{
+		std::lock_guard<std::mutex> lock(suppressionMutex_);
+		std::swap(numRepeats, numRepeats_);
+		level = lastLevel_;
+		alsoToMasterLog = lastAlsoToMasterLog_;
+	}
+	writeRepeats(numRepeats, alsoToMasterLog, level);
+}
+
+void Logger::writeRepeats(const std::uint64_t numRepeats, const bool alsoToMasterLog, const int level)
+{
+	if (numRepeats > 0) {
+		writeLine("Last message repeated " + std::to_string(numRepeats) + (numRepeats == 1 ? " time" : " times"), alsoToMasterLog, level);
+	}
+}
+
+void Logger::writeLine(const std::string& comment, const bool alsoToMasterLog, const int level)
+{
+	numLinesLogged_[level].fetch_add(1, std::memory_order_relaxed);
 	// Append to the log file: date, time & time zone, hostname, username, sampleID, program name, comment (separated by tabs)
-	const std::chrono::time_point<std::chrono::system_clock> currentTimePoint = std::chrono::system_clock::now();
-    const std::time_t currentTime = std::chrono::system_clock::to_time_t(currentTimePoint);
+	const std::time_t currentTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	const TimestampCache& timestamp = localTimestamp(currentTime);
+	LogRecord record{std::string(), timestamp.length + prefixTail_.length(), level, alsoToMasterLog, currentTime, nullptr};
+	record.line.reserve(record.prefixLength + comment.length());
+	record.line.append(timestamp.text, timestamp.length).append(prefixTail_).append(comment);
+	if (!writingAsynchronously_.load(std::memory_order_acquire) || !enqueue(std::move(record))) {
+		std::lock_guard<std::mutex> lock(myMutex_);
+		writeRecords(&record, 1);
+	}
+}
+
+void Logger::writeRecords(const LogRecord* records, const std::size_t numRecords)
+{
 	bool gotAuditTrailLock = true;
-	std::ostringstream ost;
-	ost << std::put_time(std::localtime(&currentTime), "%Y-%m-%d%t%T %Z") << '\t' << hostName_ << '\t' << userName_ << '\t' << dataID_ << '\t' << programName_ << '\t';
-		// The time format specified above is e.g. 2021-12-31 [tab] 16:00:00 EST
-	if (alsoToMasterLog) {
+	std::vector<iovec> iov;
+	iov.reserve(3 * numRecords + 4);
+	const LogRecord* firstToMasterLog = std::find_if(records, records + numRecords, [](const LogRecord& r) { return r.alsoToMasterLog; });
+	if (firstToMasterLog != records + numRecords) { // One lock and one gathered write per batch
 		Lockfile lf(lockfileName_);
 		gotAuditTrailLock = lf.hasLock(); // Should always be true, if not, add warnings to both logs
 		// Write to the audit trail even if the lock wasn't obtained, because contention is rare and omitting entries is not an option
-		std::ofstream masterLog(masterLogfileName_, std::ios::app);
-		if (!masterLog.is_open()) {
-			std::cerr << "Cannot open " << masterLogfileName_ << "... aborting." << std::endl;
-			std::exit(1);
+		const std::string_view prefix(firstToMasterLog->line.data(), firstToMasterLog->prefixLength);
+		std::string runLogSetTo; // these three are only built when needed, and outlive the gathered write
+		std::string cannotLock;
+		std::string rotatedTo;
+		if (gotAuditTrailLock) { // Another process may have rotated the master log, and only the lock holder may rotate it
+			if (rotating_) { // Processes sharing a master log are expected to share its rotation policy
+				reopenMasterLogIfRotated();
+			}
+			std::uint64_t numBytesToWrite = 0;
+			std::time_t firstSecond = firstToMasterLog->second;
+			for (std::size_t i = 0; i < numRecords; ++i) {
+				if (records[i].alsoToMasterLog) {
+					numBytesToWrite += records[i].line.length() + 1;
+					firstSecond = std::min(firstSecond, records[i].second);
+				}
+			}
+			if (rotating_) {
+				if (masterLogRotationIsDue(numBytesToWrite)) {
+					const std::string rotatedName(rotateMasterLog());
+					if (!rotatedName.empty()) {
+						rotatedTo.assign(prefix).append("Rotated the previous master log to ").append(rotatedName).push_back('\n');
+						iov.push_back(toIovec(rotatedTo));
+					}
+				}
+			}
+			if (indexDescriptor_ >= 0) {
+				addIndexCheckpoint(firstSecond, numBytesToWrite);
+			}
 		}
 		if (firstWriteToRunLog_) {
-			masterLog << ost.str() << "Run log set to " << runLogfileName_ << std::endl;
+			runLogSetTo.assign(prefix).append("Run log set to ").append(runLogfileName_).push_back('\n');
+			iov.push_back(toIovec(runLogSetTo));
 		}
 		if (!gotAuditTrailLock) {
-			masterLog << ost.str() << "**WARNING** Cannot flock() " << lockfileName_ << std::endl;
+			cannotLock.assign(prefix).append("**WARNING** Cannot flock() ").append(lockfileName_).push_back('\n');
+			iov.push_back(toIovec(cannotLock));
 		}
-		masterLog << ost.str() << comment << std::endl;
+		for (std::size_t i = 0; i < numRecords; ++i) {
+			if (records[i].alsoToMasterLog) {
+				iov.push_back(toIovec(records[i].line));
+				iov.push_back(toIovec(newline));
+			}
+		}
+		writeAll(masterLogDescriptor_, iov, masterLogfileName_);
 	}
-	if (!runLogfileName_.empty()) {
-		std::ofstream logFile(runLogfileName_, std::ios::app);
-		if (!logFile.is_open()) {
-			std::cerr << "Cannot open " << runLogfileName_ << "... aborting." << std::endl;
-			std::exit(1);
+	if (binaryRunLogDescriptor_ >= 0) {
+		std::string out;
+		for (std::size_t i = 0; i < numRecords; ++i) {
+			appendBinaryRecord(out, records[i], gotAuditTrailLock);
 		}
+		iov.assign(1, toIovec(out));
+		writeAll(binaryRunLogDescriptor_, iov, binaryRunLogfileName_);
+	} else if (runLogDescriptor_ >= 0) {
+		iov.clear();
 		if (firstWriteToRunLog_) { // Need to write the header.
-			logFile << "Date\tTime\tHost Name\tUser Name\tData ID\tProgram Name\tComment" << std::endl;
+			iov.push_back(toIovec(theRunLogHeader));
 			firstWriteToRunLog_ = false;
 		}
-		logFile << ost.str() << comment;
-		if (!gotAuditTrailLock) {
-			logFile << " **WARNING** Entry may not have been logged in master logfile";
+		for (std::size_t i = 0; i < numRecords; ++i) {
+			iov.push_back(toIovec(records[i].line));
+			if (!gotAuditTrailLock && records[i].alsoToMasterLog) {
+				iov.push_back(toIovec(noMasterLockWarning));
+			}
+			iov.push_back(toIovec(newline));
 		}
-		logFile << std::endl;
+		writeAll(runLogDescriptor_, iov, runLogfileName_);
+	}
+}
+
+void Logger::appendBinaryRecord(std::string& out, const LogRecord& record, const bool gotAuditTrailLock)
+{
+	if (record.second != lastBinarySecond_) {
+		const TimestampCache& timestamp = localTimestamp(record.second);
+		out.push_back(LogFormat::_timestampRecord_);
+		LogFormat::appendRaw(out, static_cast<std::int64_t>(record.second));
+		LogFormat::appendRaw(out, static_cast<std::uint8_t>(timestamp.length));
+		out.append(timestamp.text, timestamp.length);
+		lastBinarySecond_ = record.second;
+	}
+	const LogFormat& format = record.format ? *record.format : LogFormat::plainText();
+	if (format.itsID() >= formatsDefined_.size()) {
+		formatsDefined_.resize(format.itsID() + 1, false);
+	}
+	if (!formatsDefined_[format.itsID()]) {
+		out.push_back(LogFormat::_definitionRecord_);
+		LogFormat::appendRaw(out, format.itsID());
+		LogFormat::appendRaw(out, static_cast<std::uint32_t>(format.itsFormat().length()));
+		out += format.itsFormat();
+		formatsDefined_[format.itsID()] = true;
+	}
+	out.push_back(LogFormat::_logRecord_);
+	LogFormat::appendRaw(out, format.itsID());
+	LogFormat::appendRaw(out, static_cast<std::uint8_t>(record.level));
+	if (record.format) {
+		LogFormat::appendRaw(out, static_cast<std::uint32_t>(record.line.length()));
+		out += record.line;
+	} else { // A text entry, which becomes the single argument of the plain text format
+		std::string_view comment(record.line);
+		comment.remove_prefix(record.prefixLength);
+		const bool warn = (!gotAuditTrailLock && record.alsoToMasterLog);
+		const std::size_t commentLength = comment.length() + (warn ? noMasterLockWarning.length() : 0);
+		LogFormat::appendRaw(out, static_cast<std::uint32_t>(1 + sizeof(std::uint32_t) + commentLength));
+		out.push_back(LogFormat::_string_);
+		LogFormat::appendRaw(out, static_cast<std::uint32_t>(commentLength));
+		out += comment;
+		if (warn) {
+			out += noMasterLockWarning;
+		}
+	}
+}
+
+bool Logger::enqueue(LogRecord&& record)
+{
+	std::unique_lock<std::mutex> lock(queueMutex_);
+	if (stopWriter_) return false; // the writer may already have drained the queue for the last time
+	if (queue_.size() >= queueCapacity_) {
+		switch (overflowPolicy_) {
+			case Overflow::_drop_debug_:
+				if (record.level == _debug_) {
+					++numDropped_;
+					numLinesDropped_.fetch_add(1, std::memory_order_relaxed);
+					return true;
+				}
+				[[fallthrough]]; // block for more important records
+			case Overflow::_block_:
+				queueNotFull_.wait(lock, [this]() { return queue_.size() < queueCapacity_ || stopWriter_; });
+				if (stopWriter_) return false;
+				break;
+			case Overflow::_drop_oldest_:
+				queue_.pop_front();
+				++numDropped_;
+				numLinesDropped_.fetch_add(1, std::memory_order_relaxed);
+				++numWritten_; // accounted for, so that flush() does not wait for it
+				break;
+		}
+	}
+	queue_.push_back(std::move(record));
+	++numEnqueued_;
+	queueNotEmpty_.notify_one();
+	return true;
+}
+
+void Logger::writerLoop()
+{
+	std::vector<LogRecord> batch;
+	batch.reserve(queueCapacity_);
+	for (;;) {
+		std::uint64_t numDropped = 0;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex_);
+			queueNotEmpty_.wait(lock, [this]() { return !queue_.empty() || stopWriter_; });
+			if (queue_.empty()) break; // stopWriter_, and everything has been written
+			std::move(queue_.begin(), queue_.end(), std::back_inserter(batch));
+			queue_.clear();
+			numDropped = numDropped_;
+			numDropped_ = 0;
+		}
+		queueNotFull_.notify_all();
+		if (numDropped > 0) { // Report the loss within the log itself
+			const std::time_t second = batch.back().second;
+			LogRecord warning{linePrefix(second), 0, _warn_, true, second, nullptr};
+			warning.prefixLength = warning.line.length();
+			warning.line += "**WARNING** " + std::to_string(numDropped) + " log entries were dropped because the asynchronous log queue was full";
+			batch.push_back(std::move(warning));
+		}
+		{
+			std::lock_guard<std::mutex> lock(myMutex_);
+			writeRecords(batch.data(), batch.size());
+		}
+		{
+			std::lock_guard<std::mutex> lock(queueMutex_);
+			numWritten_ += batch.size() - (numDropped > 0 ? 1 : 0);
+		}
+		queueFlushed_.notify_all();
+		batch.clear();
 	}
 }
 
@@ -149,20 +738,113 @@ void Logger::debugToLog(const std::string& comment, const bool alsoToMasterLog)
 	addToLog(comment, alsoToMasterLog, _debug_);
 }
 
-void Logger::errorToLog(const std::string& comment)
+void Logger::addDeferredRecord(const int level, const LogFormat& format, std::string&& encodedArguments)
 {
-	addToLog("***ERROR*** " + comment, true, _error_);
-	std::cerr << comment << std::endl;
-	std::lock_guard<std::mutex> lock(myMutex_);
-	++numErrorsLogged_;
+	assert(notDoneWritingLog_);
+	if (level < getLogLevel()) { // for the crash ring only, which formats it if it is ever dumped
+		if (level >= crashRingLevel_.load(std::memory_order_acquire)) {
+			appendDeferredToCrashRing(format, encodedArguments);
+		}
+		return;
+	}
+	if (binaryRunLogDescriptor_ < 0) { // Format it now (and count it) via addToLog()
+		addToLog(expandLogFormat(format.itsFormat(), encodedArguments), false, level);
+		return;
+	}
+	assert(level < _numLogLevels_);
+	numLinesLogged_[level].fetch_add(1, std::memory_order_relaxed);
+	LogRecord record{std::move(encodedArguments), 0, level, false, std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), &format};
+	if (!writingAsynchronously_.load(std::memory_order_acquire) || !enqueue(std::move(record))) {
+		std::lock_guard<std::mutex> lock(myMutex_);
+		writeRecords(&record, 1);
+	}
 }
 
-void Logger::warningToLog(const std::string& comment)
+void Logger::openBinaryRunLog(const std::string& binaryRunLogfileName)
 {
-	addToLog("**WARNING** " + comment, true, _warn_);
-	std::cerr << comment << std::endl;
+	if (binaryRunLogDescriptor_ >= 0) {
+		throw std::runtime_error("Logger::openBinaryRunLog(), already writing to " + binaryRunLogfileName_);
+	}
+	if (binaryRunLogfileName == masterLogfileName_ || binaryRunLogfileName == runLogfileName_) {
+		throw std::runtime_error("Logger::openBinaryRunLog(), " + binaryRunLogfileName + " is already in use as a text log");
+	}
+	addToLog("Binary run log set to " + binaryRunLogfileName);
+	flush(); // so that text entries precede the switch
+	const int fd = open(binaryRunLogfileName.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (fd < 0) {
+		throw std::runtime_error("Logger::openBinaryRunLog(), cannot open " + binaryRunLogfileName + " (" + std::strerror(errno) + ')');
+	}
+	std::string fileHeader(LogFormat::fileMagic, sizeof(LogFormat::fileMagic) - 1);
+	LogFormat::appendRaw(fileHeader, static_cast<std::uint32_t>(prefixTail_.length()));
+	fileHeader += prefixTail_;
+	std::vector<iovec> iov(1, toIovec(fileHeader));
 	std::lock_guard<std::mutex> lock(myMutex_);
-	++numWarningsLogged_;
+	writeAll(fd, iov, binaryRunLogfileName);
+	binaryRunLogfileName_ = binaryRunLogfileName;
+	binaryRunLogDescriptor_ = fd;
+}
+
+void Logger::errorToLog(const std::string& comment, const std::string& rateLimitKey)
+{
+	numErrorsLogged_.fetch_add(1, std::memory_order_relaxed);
+	std::uint64_t numSuppressed = 0;
+	if (!rateLimitKey.empty() && !withinRateLimit(rateLimitKey, &numSuppressed)) return;
+	if (numSuppressed > 0) {
+		addToLog("***ERROR*** " + std::to_string(numSuppressed) + " entries with rate limit key \"" + rateLimitKey + "\" were suppressed", true, _error_);
+	}
+	if (addToLogUnlessRepeated("***ERROR*** " + comment, true, _error_)) {
+		std::cerr << comment << std::endl;
+	}
+}
+
+void Logger::warningToLog(const std::string& comment, const std::string& rateLimitKey)
+{
+	numWarningsLogged_.fetch_add(1, std::memory_order_relaxed);
+	std::uint64_t numSuppressed = 0;
+	if (!rateLimitKey.empty() && !withinRateLimit(rateLimitKey, &numSuppressed)) return;
+	if (numSuppressed > 0) {
+		addToLog("**WARNING** " + std::to_string(numSuppressed) + " entries with rate limit key \"" + rateLimitKey + "\" were suppressed", true, _warn_);
+	}
+	if (addToLogUnlessRepeated("**WARNING** " + comment, true, _warn_)) {
+		std::cerr << comment << std::endl;
+	}
+}
+
+void Logger::setRepeatSuppression(const bool suppress)
+{
+	reportRepeats();
+	std::lock_guard<std::mutex> lock(suppressionMutex_);
+	lastComment_.clear();
+	suppressRepeats_ = suppress;
+}
+
+void Logger::setRateLimit(const std::string& rateLimitKey, const double messagesPerSecond, const double burst)
+{
+	if (messagesPerSecond <= 0.0 || burst < 1.0) {
+		throw std::runtime_error("Logger::setRateLimit(), bad rate or burst specified for key " + rateLimitKey);
+	}
+	std::lock_guard<std::mutex> lock(suppressionMutex_);
+	rateLimits_[rateLimitKey] = TokenBucket{messagesPerSecond, burst, burst, std::chrono::steady_clock::now(), 0};
+}
+
+bool Logger::withinRateLimit(const std::string& key, std::uint64_t* numSuppressedBefore)
+{
+	std::lock_guard<std::mutex> lock(suppressionMutex_);
+	const auto it = rateLimits_.find(key);
+	if (it == rateLimits_.end()) return true;
+	TokenBucket& bucket = it->second;
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	bucket.tokens = std::min(bucket.burst, bucket.tokens + bucket.messagesPerSecond * std::chrono::duration<double>(now - bucket.lastRefill).count());
+	bucket.lastRefill = now;
+	if (bucket.tokens < 1.0) {
+		++bucket.numSuppressed;
+		numLinesSuppressed_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	bucket.tokens -= 1.0;
+	*numSuppressedBefore = bucket.numSuppressed;
+	bucket.numSuppressed = 0;
+	return true;
 }
 
 int Logger::endLog(int returnCode)
@@ -180,24 +862,330 @@ int Logger::endLog(int returnCode)
 	elapsed_seconds -= hours * 3600;
 	const int minutes = elapsed_seconds / 60;
 	elapsed_seconds -= minutes * 60;
+	reportRepeats();
 	ost << days << ':' << std::setfill('0') << std::setw(2) << hours << ':' << std::setw(2) << minutes << ':' << std::setw(2) << elapsed_seconds << '\n';
 	addToLog(ost.str());
+	stopAsynchronousWriting(); // waits for everything to be written
+	stopBackgroundCompression(); // waits for rotated master logs to be compressed
+	if (crashRing_) crashRing_->dump();
 	notDoneWritingLog_ = false; // done logging
 	return returnCode;
 }
 
+void Logger::startAsynchronousWriting(std::size_t queueCapacity, Overflow policy)
+{
+	if (queueCapacity == 0) {
+		throw std::runtime_error("Logger::startAsynchronousWriting(), the queue capacity must be positive");
+	}
+	if (writingAsynchronously_.load(std::memory_order_acquire)) {
+		throw std::runtime_error("Logger::startAsynchronousWriting(), already writing asynchronously");
+	}
+	queueCapacity_ = queueCapacity;
+	overflowPolicy_ = policy;
+	stopWriter_ = false;
+	writerThread_ = std::thread(&Logger::writerLoop, this);
+	writingAsynchronously_.store(true, std::memory_order_release);
+}
+
+void Logger::flush()
+{
+	if (writingAsynchronously_.load(std::memory_order_acquire)) {
+		std::unique_lock<std::mutex> lock(queueMutex_);
+		const std::uint64_t target = numEnqueued_;
+		queueFlushed_.wait(lock, [this, target]() { return numWritten_ >= target; });
+	}
+}
+
+void Logger::stopAsynchronousWriting()
+{
+	if (writingAsynchronously_.load(std::memory_order_acquire)) {
+		{ // From now on, enqueue() refuses records, so that what the writer drains is all there is
+			std::lock_guard<std::mutex> lock(queueMutex_);
+			stopWriter_ = true;
+		}
+		queueNotEmpty_.notify_one();
+		queueNotFull_.notify_all(); // blocked producers write their records themselves
+		writerThread_.join(); // the writer drains the queue before returning
+		writingAsynchronously_.store(false, std::memory_order_release);
+	}
+}
+
+void Logger::setRotationPolicy(const RotationPolicy& policy)
+{
+	if (policy.numRetained < 0) {
+		throw std::runtime_error("Logger::setRotationPolicy(), the number of rotated master logs to retain must not be negative");
+	}
+	{
+		std::lock_guard<std::mutex> lock(myMutex_);
+		rotationPolicy_ = policy;
+		rotating_ = (policy.maxBytes > 0 || policy.daily);
+	}
+	if (rotating_ && !compressionThread_.joinable()) {
+		stopCompression_ = false;
+		compressionThread_ = std::thread(&Logger::compressionLoop, this);
+	}
+}
+
+void Logger::reopenMasterLogIfRotated()
+{ // Compares the file at masterLogfileName_ with the one we hold open
+	struct stat named, held;
+	if (stat(masterLogfileName_.c_str(), &named) != 0 || fstat(masterLogDescriptor_, &held) != 0 || named.st_ino != held.st_ino || named.st_dev != held.st_dev) {
+		close(masterLogDescriptor_);
+		masterLogDescriptor_ = openLogForAppending(masterLogfileName_);
+		if (indexDescriptor_ >= 0) { // the index is removed along with the rotated master log
+			close(indexDescriptor_);
+			indexDescriptor_ = openLogForAppending(indexFileName(masterLogfileName_), O_RDWR); // read by addIndexCheckpoint()
+		}
+	}
+}
+
+void Logger::addIndexCheckpoint(const std::time_t second, const std::uint64_t numBytesToWrite)
+{ // A checkpoint whenever the master log starts, or is about to cross a multiple of indexIntervalBytes_,
+	// which keeps the index sparse, even when several processes are adding to it.
+	struct stat held;
+	if (fstat(masterLogDescriptor_, &held) != 0) return;
+	const std::uint64_t offset = held.st_size;
+	if (offset == 0 || offset / indexIntervalBytes_ != (offset + numBytesToWrite) / indexIntervalBytes_) {
+		IndexCheckpoint checkpoint{static_cast<std::int64_t>(second), offset};
+		// A batch can start earlier than another process's last checkpoint; keep the index sorted for LogQuery
+		IndexCheckpoint previous;
+		struct stat index;
+		if (fstat(indexDescriptor_, &index) == 0 && index.st_size >= static_cast<off_t>(sizeof(previous))) {
+			const off_t lastOffset = index.st_size - index.st_size % sizeof(previous) - sizeof(previous);
+			if (pread(indexDescriptor_, &previous, sizeof(previous), lastOffset) == sizeof(previous)) {
+				checkpoint.second = std::max(checkpoint.second, previous.second);
+			}
+		}
+		std::vector<iovec> iov(1, iovec{const_cast<IndexCheckpoint*>(&checkpoint), sizeof(checkpoint)});
+		writeAll(indexDescriptor_, iov, indexFileName(masterLogfileName_));
+	}
+}
+
+void Logger::enableMasterLogIndex(const std::uint64_t checkpointIntervalBytes)
+{
+	if (checkpointIntervalBytes == 0) {
+		throw std::runtime_error("Logger::enableMasterLogIndex(), the checkpoint interval must be positive");
+	}
+	std::lock_guard<std::mutex> lock(myMutex_);
+	indexIntervalBytes_ = checkpointIntervalBytes;
+	if (indexDescriptor_ < 0) {
+		indexDescriptor_ = openLogForAppending(indexFileName(masterLogfileName_), O_RDWR); // read by addIndexCheckpoint()
+	}
+}
+
+void Logger::enableCrashRing(const std::size_t numBytes)
+{
+	std::lock_guard<std::mutex> lock(myMutex_);
+	if (crashRing_) {
+		throw std::runtime_error("Logger::enableCrashRing(), already enabled");
+	}
+	const std::string dumpFileName(crashRingFileName(itsRunLogfileName()));
+	if (numBytes == 0 || dumpFileName.length() >= PATH_MAX) {
+		throw std::runtime_error("Logger::enableCrashRing(), bad size or file name");
+	}
+	void* mapped = mmap(nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapped == MAP_FAILED) {
+		throw std::runtime_error("Logger::enableCrashRing(), cannot map " + std::to_string(numBytes) + " bytes (" + std::strerror(errno) + ')');
+	}
+	CrashRing* ring = new CrashRing;
+	ring->data = static_cast<char*>(mapped);
+	ring->size = numBytes;
+	ring->end.store(0, std::memory_order_relaxed);
+	std::strcpy(ring->dumpFileName, dumpFileName.c_str());
+	ring->prefixTail = &prefixTail_;
+	CrashRing* noRing = nullptr;
+	if (!activeCrashRing_.compare_exchange_strong(noRing, ring)) {
+		munmap(mapped, numBytes);
+		delete ring;
+		throw std::runtime_error("Logger::enableCrashRing(), another Logger in this process has a crash ring");
+	}
+	struct sigaction action;
+	std::memset(&action, 0, sizeof(action));
+	action.sa_handler = crashSignalHandler;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGSEGV, &action, &ring->previousSegvAction);
+	sigaction(SIGABRT, &action, &ring->previousAbortAction);
+	crashRing_ = ring;
+	crashRingLevel_.store(_debug_, std::memory_order_release); // publishes crashRing_ to addToLogUnlessRepeated()
+}
+
+void Logger::appendToCrashRing(const std::string& comment)
+{
+	thread_local std::string line; // reused, so that a debug entry allocates nothing once warmed up
+	const TimestampCache& timestamp = localTimestamp(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+	line.assign(timestamp.text, timestamp.length).append(prefixTail_).append(comment).push_back('\n');
+	crashRing_->append(line.data(), line.length());
+}
+
+void Logger::appendDeferredToCrashRing(const LogFormat& format, const std::string& encodedArguments)
+{
+	const TimestampCache& timestamp = localTimestamp(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+	const LogFormat* const formatPointer = &format;
+	if (1 + timestamp.length + sizeof(formatPointer) + encodedArguments.length() > CrashRing::maxRecordLength) {
+		appendToCrashRing(expandLogFormat(format.itsFormat(), encodedArguments));
+		return;
+	}
+	thread_local std::string line; // reused, as in appendToCrashRing()
+	line.assign(1, CrashRing::_deferredRecord_);
+	const std::uint8_t timestampLength = timestamp.length;
+	CrashRing::appendEscaped(line, reinterpret_cast<const char*>(&timestampLength), sizeof(timestampLength));
+	CrashRing::appendEscaped(line, timestamp.text, timestamp.length);
+	CrashRing::appendEscaped(line, reinterpret_cast<const char*>(&formatPointer), sizeof(formatPointer));
+	CrashRing::appendEscaped(line, encodedArguments.data(), encodedArguments.length());
+	line.push_back('\n');
+	crashRing_->append(line.data(), line.length());
+}
+
+bool Logger::masterLogRotationIsDue(const std::uint64_t numBytesToWrite)
+{
+	struct stat held;
+	if (fstat(masterLogDescriptor_, &held) != 0 || held.st_size == 0) {
+		return false;
+	}
+	if (rotationPolicy_.maxBytes > 0 && static_cast<std::uint64_t>(held.st_size) + numBytesToWrite > rotationPolicy_.maxBytes) {
+		return true;
+	}
+	if (rotationPolicy_.daily) {
+		return currentDateYYYYMMDD() != currentDateYYYYMMDD(std::chrono::system_clock::from_time_t(held.st_mtime));
+	}
+	return false;
+}
+
+std::string Logger::rotateMasterLog()
+{ // Returns the rotated file's name, or an empty string if the master log could not be renamed
+	const std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
+	const std::time_t currentTime = std::chrono::system_clock::to_time_t(now);
+	std::tm localTime;
+	localtime_r(&currentTime, &localTime);
+	char hhmmss[6];
+	formatDigits(formatDigits(formatDigits(hhmmss, localTime.tm_hour, 2), localTime.tm_min, 2), localTime.tm_sec, 2);
+	const std::string stem(masterLogfileName_ + '.' + currentDateYYYYMMDD(now) + '-' + std::string(hhmmss, sizeof(hhmmss)));
+	std::string rotatedName(stem);
+	for (int n = 2; fs::exists(rotatedName) || fs::exists(rotatedName + ".gz"); ++n) {
+		rotatedName = stem + '-' + padWithLeadingCharacters(std::to_string(n), 3, '0'); // so that names sort chronologically
+	}
+	if (std::rename(masterLogfileName_.c_str(), rotatedName.c_str()) != 0) {
+		std::cerr << "Cannot rename " << masterLogfileName_ << " to " << rotatedName << " (" << std::strerror(errno) << ')' << std::endl;
+		return std::string(); // keep appending to the current master log
+	}
+	close(masterLogDescriptor_);
+	masterLogDescriptor_ = openLogForAppending(masterLogfileName_);
+	std::remove(indexFileName(masterLogfileName_).c_str()); // Offsets in the old index refer to the rotated file
+	if (indexDescriptor_ >= 0) {
+		close(indexDescriptor_);
+		indexDescriptor_ = openLogForAppending(indexFileName(masterLogfileName_), O_RDWR); // read by addIndexCheckpoint()
+	}
+	{
+		std::lock_guard<std::mutex> lock(compressionMutex_);
+		filesToCompress_.push_back(rotatedName);
+	}
+	compressionRequested_.notify_one();
+	return rotatedName;
+}
+
+void Logger::compressionLoop()
+{
+	for (;;) {
+		std::string fileName;
+		{
+			std::unique_lock<std::mutex> lock(compressionMutex_);
+			compressionRequested_.wait(lock, [this]() { return !filesToCompress_.empty() || stopCompression_; });
+			if (filesToCompress_.empty()) break; // stopCompression_, and nothing left to do
+			fileName = std::move(filesToCompress_.front());
+			filesToCompress_.pop_front();
+		}
+		RotationPolicy policy;
+		{
+			std::lock_guard<std::mutex> lock(myMutex_);
+			policy = rotationPolicy_;
+		}
+		try {
+			if (policy.compress && fs::exists(fileName)) { // unless another process has already pruned it
+				const int status = gzipFile(fileName);
+				if (status && fs::exists(fileName)) {
+					std::cerr << "Cannot compress " << fileName << " (gzip exit status " << status << ')' << std::endl;
+				}
+			}
+			pruneRotatedMasterLogs(policy.numRetained);
+		} catch (std::exception& e) { // Not worth stopping the application for
+			std::cerr << "Logger::compressionLoop(): " << e.what() << std::endl;
+		}
+	}
+}
+
+void Logger::pruneRotatedMasterLogs(const int numRetained)
+{ // Rotated names, masterLogfileName_.YYYYMMDD-HHMMSS[-nnn][.gz], sort chronologically once any ".gz" is ignored
+	const Lockfile lf(lockfileName_); // waits, so that we do not race another process that is rotating or pruning
+	const fs::path master(masterLogfileName_);
+	const fs::path directory(master.has_parent_path() ? master.parent_path() : fs::path("."));
+	const std::string rotatedPrefix(master.filename().string() + '.');
+	std::vector<fs::path> rotated;
+	for (const auto& f : listFilesInDirectory(directory)) {
+		const std::string name(f.filename().string());
+		if (beginsWith(name, rotatedPrefix) && name.length() >= rotatedPrefix.length() + 15 && std::isdigit(static_cast<unsigned char>(name[rotatedPrefix.length()]))) {
+			rotated.push_back(f);
+		}
+	}
+	if (rotated.size() > static_cast<std::size_t>(numRetained)) {
+		auto withoutGz = [](const fs::path& f) { return f.extension() == ".gz" ? f.stem().string() : f.filename().string(); };
+		std::sort(rotated.begin(), rotated.end(), [&withoutGz](const fs::path& a, const fs::path& b) { return withoutGz(a) < withoutGz(b); });
+		for (std::size_t i = 0; i < rotated.size() - numRetained; ++i) {
+			std::remove(rotated[i].c_str()); // may already have been pruned by another process
+		}
+	}
+}
+
+void Logger::stopBackgroundCompression()
+{
+	if (compressionThread_.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(compressionMutex_);
+			stopCompression_ = true;
+		}
+		compressionRequested_.notify_one();
+		compressionThread_.join(); // the compression thread finishes its queue before returning
+	}
+}
+
+Logger::Counters Logger::counters() const
+{
+	Counters c;
+	c.numErrors = numErrorsLogged();
+	c.numWarnings = numWarningsLogged();
+	for (int level = 0; level < _numLogLevels_; ++level) {
+		c.numLines[level] = numLinesLogged_[level].load(std::memory_order_relaxed);
+	}
+	c.numLinesDropped = numLinesDropped_.load(std::memory_order_relaxed);
+	c.numLinesSuppressed = numLinesSuppressed_.load(std::memory_order_relaxed);
+	c.logLevel = getLogLevel();
+	return c;
+}
+
+std::string Logger::linePrefix(const std::time_t second) const
+{
+	const TimestampCache& timestamp = localTimestamp(second);
+	return std::string(timestamp.text, timestamp.length) + prefixTail_;
+}
+
+const std::string& Logger::runLogHeader()
+{
+	return theRunLogHeader;
+}
+
 void Logger::setLogLevel(int newLevel)
 {
 	if (newLevel < 0 || newLevel >= _numLogLevels_) {
 		throw std::runtime_error("Logger::setLogLevel(), bad log level " + std::to_string(newLevel) + " specified");
 	}
-	logLevel_ = newLevel;
+	logLevel_.store(newLevel, std::memory_order_relaxed);
 }
 
 std::string currentDateYYYYMMDD(const std::chrono::time_point<std::chrono::system_clock>& theTime)
 {
 	const std::time_t currentTime = std::chrono::system_clock::to_time_t(theTime);
+	std::tm localTime;
+	localtime_r(&currentTime, &localTime); // thread-safe, unlike std::localtime()
 	std::ostringstream ost;
-	ost << std::put_time(std::localtime(&currentTime), "%Y%m%d");
+	ost << std::put_time(&localTime, "%Y%m%d");
 	return ost.str();
 }
@@ -1,8 +1,8 @@
 // classLogger.h
-// Version 2016.10.19
+// Version 2026.10.16
 
 /*
-Copyright (c) 2013-2016, NeuroGadgets Inc.
+Copyright (c) 2013-2026, NeuroGadgets Inc.
 Author: Robert L. Charlebois
 All rights reserved.
 
@@ -34,15 +34,49 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef CLASS_LOGGER_H
 #define CLASS_LOGGER_H
 
+#include "classLogFormat.h"
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <map>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 std::string currentDateYYYYMMDD(const std::chrono::time_point<std::chrono::system_clock>& theTime = std::chrono::system_clock::now());
 
 class Logger {
+public:
+	enum { _debug_, _info_, _warn_, _error_, _numLogLevels_ };
+	enum class Overflow { _block_, _drop_debug_, _drop_oldest_ }; // what enqueueing does when the asynchronous queue is full
+	struct RotationPolicy { // for the master log, which is shared by processes that cooperate through its lockfile
+		std::uint64_t maxBytes = 0; // rotate rather than let the master log exceed this size; 0 for no limit
+		bool daily = false; // rotate when the master log was last written on an earlier date
+		int numRetained = 7; // rotated master logs to keep; older ones are deleted
+		bool compress = true; // gzip rotated master logs on a background thread
+	};
+	struct IndexCheckpoint { // sidecar index entry: master log lines from this offset on were written from about this time on
+		std::int64_t second; // since the epoch, in UTC; nondecreasing through the index, even with several processes
+		std::uint64_t offset;
+	};
+	static std::string indexFileName(const std::string& logFileName) { return logFileName + ".idx"; }
+	static std::string crashRingFileName(const std::string& logFileName) { return logFileName + ".ring"; }
 private:
+	struct LogRecord {
+		std::string line; // prefix and comment, without the trailing '\n'
+		std::size_t prefixLength;
+		int level;
+		bool alsoToMasterLog;
+		std::time_t second;
+		const LogFormat* format; // nullptr for text; otherwise line holds the encoded arguments, for the binary run log
+	};
+
     std::chrono::time_point<std::chrono::system_clock> startTimePoint_;
 	std::mutex myMutex_;
 	std::string masterLogfileName_; // assumed to be shared
@@ -53,13 +87,94 @@ private:
 	std::string userName_;
 	std::string hostName_;
 	std::string dataID_;
-	int numErrorsLogged_;
-	int numWarningsLogged_;
-	int logLevel_;
+	std::string prefixTail_; // the constant part of each line's prefix, from hostName_ to programName_
+	int masterLogDescriptor_; // kept open (O_APPEND) for the lifetime of the Logger
+	int runLogDescriptor_; // -1 if there is no run log
+	int indexDescriptor_; // -1 unless enableMasterLogIndex() was called
+	std::uint64_t indexIntervalBytes_;
+	int binaryRunLogDescriptor_; // -1 unless openBinaryRunLog() was called
+	std::string binaryRunLogfileName_;
+	std::vector<bool> formatsDefined_; // within the binary run log, indexed by LogFormat ID
+	std::time_t lastBinarySecond_; // of the last 'T' record in the binary run log
+	std::atomic<int> numErrorsLogged_;
+	std::atomic<int> numWarningsLogged_;
+	std::array<std::atomic<std::uint64_t>, _numLogLevels_> numLinesLogged_; // per level, including lines dropped by the queue
+	std::atomic<std::uint64_t> numLinesDropped_;
+	std::atomic<std::uint64_t> numLinesSuppressed_; // by repeat coalescing or rate limiting
+	std::atomic<int> logLevel_; // read without locking, before any comment is built
 	bool notDoneWritingLog_;
 	bool firstWriteToRunLog_;
+
+	// Asynchronous mode: callers enqueue records, and writerThread_ drains them in batches
+	std::mutex queueMutex_;
+	std::condition_variable queueNotEmpty_;
+	std::condition_variable queueNotFull_;
+	std::condition_variable queueFlushed_;
+	std::deque<LogRecord> queue_;
+	std::thread writerThread_;
+	std::size_t queueCapacity_;
+	std::uint64_t numEnqueued_;
+	std::uint64_t numWritten_; // includes dropped records, so that flush() can compare with numEnqueued_
+	std::uint64_t numDropped_; // not yet reported in the log
+	Overflow overflowPolicy_;
+	std::atomic<bool> writingAsynchronously_; // read by producers without locking
+	bool stopWriter_; // requires queueMutex_
+
+	// Coalescing of identical consecutive entries, and per-key rate limiting
+	struct TokenBucket {
+		double messagesPerSecond;
+		double burst;
+		double tokens;
+		std::chrono::steady_clock::time_point lastRefill;
+		std::uint64_t numSuppressed; // since the last entry that was allowed through
+	};
+	std::mutex suppressionMutex_; // held to compare with lastComment_, not while writing
+	std::string lastComment_;
+	int lastLevel_;
+	bool lastAlsoToMasterLog_;
+	std::uint64_t numRepeats_; // of lastComment_, not yet reported
+	std::chrono::steady_clock::time_point firstRepeat_;
+	std::map<std::string, TokenBucket> rateLimits_;
+	std::atomic<bool> suppressRepeats_;
+
+	// Master log rotation; rotated files are compressed and pruned by compressionThread_
+	RotationPolicy rotationPolicy_;
+	bool rotating_;
+	std::mutex compressionMutex_;
+	std::condition_variable compressionRequested_;
+	std::deque<std::string> filesToCompress_;
+	std::thread compressionThread_;
+	bool stopCompression_;
+
+	// In-memory ring of recent entries, including debug entries below logLevel_, dumped on a crash and by endLog()
+	struct CrashRing;
+	CrashRing* crashRing_; // nullptr unless enableCrashRing() was called
+	std::atomic<int> crashRingLevel_; // _debug_ with a crash ring, otherwise _numLogLevels_
+	static std::atomic<CrashRing*> activeCrashRing_; // the one dumped by crashSignalHandler()
+	static void crashSignalHandler(int signalNumber);
+
+	std::string linePrefix(std::time_t second) const;
+	void writeLine(const std::string& comment, bool alsoToMasterLog, int level);
+	bool addToLogUnlessRepeated(const std::string& comment, bool alsoToMasterLog, int level); // false if coalesced
+	void reportRepeats(); // of the last entry, if it was coalesced
+	void writeRepeats(std::uint64_t numRepeats, bool alsoToMasterLog, int level);
+	bool withinRateLimit(const std::string& key, std::uint64_t* numSuppressedBefore);
+	void writeRecords(const LogRecord* records, std::size_t numRecords); // requires myMutex_
+	void reopenMasterLogIfRotated(); // requires myMutex_ and the master lockfile
+	bool masterLogRotationIsDue(std::uint64_t numBytesToWrite); // ditto
+	void addIndexCheckpoint(std::time_t second, std::uint64_t numBytesToWrite); // ditto
+	std::string rotateMasterLog(); // ditto
+	void compressionLoop();
+	void pruneRotatedMasterLogs(int numRetained);
+	void stopBackgroundCompression();
+	void appendBinaryRecord(std::string& out, const LogRecord& record, bool gotAuditTrailLock); // requires myMutex_
+	void addDeferredRecord(int level, const LogFormat& format, std::string&& encodedArguments);
+	void appendToCrashRing(const std::string& comment);
+	void appendDeferredToCrashRing(const LogFormat& format, const std::string& encodedArguments);
+	bool enqueue(LogRecord&& record); // false, leaving record intact, once the writer is stopping
+	void writerLoop();
+	void stopAsynchronousWriting();
 public:
-	enum { _debug_, _info_, _warn_, _error_, _numLogLevels_ };
 	Logger(const std::string& masterLogfileName, const std::string& runLogfileName, const std::string& dataID, const std::string& commandLine, const std::string& specifiedUser = std::string());
 	~Logger();
 
@@ -69,20 +184,27 @@ public:
 	const std::string& itsRunLogfileName() const {
 		return runLogfileName_.empty() ? masterLogfileName_ : runLogfileName_;
 	}
-	int numErrorsLogged() {
-		std::lock_guard<std::mutex> lock(myMutex_);
-		return numErrorsLogged_;
-	}
-	int numWarningsLogged() {
-		std::lock_guard<std::mutex> lock(myMutex_);
-		return numWarningsLogged_;
-	}
-	int numIssuesLogged() {
-		std::lock_guard<std::mutex> lock(myMutex_);
-		return numErrorsLogged_ + numWarningsLogged_;
-	}
+	int numErrorsLogged() const { return numErrorsLogged_.load(std::memory_order_relaxed); }
+	int numWarningsLogged() const { return numWarningsLogged_.load(std::memory_order_relaxed); }
+	int numIssuesLogged() const { return numErrorsLogged() + numWarningsLogged(); }
+
+	struct Counters {
+		int numErrors;
+		int numWarnings;
+		std::array<std::uint64_t, _numLogLevels_> numLines; // indexed by level
+		std::uint64_t numLinesDropped; // by the asynchronous queue's overflow policy
+		std::uint64_t numLinesSuppressed; // by repeat coalescing or rate limiting
+		int logLevel;
+	};
+	Counters counters() const; // lock-free, for monitoring threads; each counter is read atomically, not the set
 	
-	int getLogLevel() const { return logLevel_; }
+	int getLogLevel() const { return logLevel_.load(std::memory_order_relaxed); }
+	bool isLogged(const int level) const {
+		return level >= logLevel_.load(std::memory_order_relaxed);
+	}
+	bool isRecorded(const int level) const {
+		return isLogged(level) || level >= crashRingLevel_.load(std::memory_order_relaxed);
+	} // logged, or at least kept in the crash ring
 	void setLogLevel(int newLevel);
 	
 	std::string startDateYYYYMMDD() const { return currentDateYYYYMMDD(startTimePoint_); }
@@ -91,8 +213,36 @@ public:
 
 	void debugToLog(const std::string& comment, const bool alsoToMasterLog = true);
 	void addToLog(const std::string& comment, const bool alsoToMasterLog = true, const int level = _info_);
-	void errorToLog(const std::string& comment);
-	void warningToLog(const std::string& comment);
+	void errorToLog(const std::string& comment, const std::string& rateLimitKey = std::string());
+	void warningToLog(const std::string& comment, const std::string& rateLimitKey = std::string());
+		// Suppressed errors and warnings are still counted by numErrorsLogged() and numWarningsLogged()
+
+	void setRepeatSuppression(bool suppress); // off by default; if on, identical consecutive entries become "Last message repeated N times"
+	void setRateLimit(const std::string& rateLimitKey, double messagesPerSecond, double burst);
+		// Token bucket for errors and warnings logged with this key; keys without a limit are not limited
+
+	void openBinaryRunLog(const std::string& binaryRunLogfileName);
+		// From then on, run log entries are written in binary form, to be read with the ngilogdecode tool
+	template<typename... Args> void deferredToLog(const int level, const LogFormat& format, const Args&... args) {
+		if (!isRecorded(level)) return;
+		std::string encodedArguments;
+		LogFormat::encodeArguments(encodedArguments, args...);
+		addDeferredRecord(level, format, std::move(encodedArguments));
+	} // Run log only; the arguments are only formatted if the run log is not binary, or if the crash ring is dumped.
+	static const std::string& runLogHeader(); // the first line of a text run log, including '\n'
+
+	void setRotationPolicy(const RotationPolicy& policy);
+		// Every process sharing the master log should set one; without it, a Logger does not notice another's rotation
+	void enableMasterLogIndex(std::uint64_t checkpointIntervalBytes = 65536);
+		// Maintains indexFileName(masterLogfileName), for time-range queries with LogQuery
+	void enableCrashRing(std::size_t numBytes = 1 << 20);
+		// Keeps the last numBytes of entries in memory, at every level, and writes them to
+		// crashRingFileName(itsRunLogfileName()) on SIGSEGV, SIGABRT or endLog(). One Logger per process.
+
+	void startAsynchronousWriting(std::size_t queueCapacity = 8192, Overflow policy = Overflow::_block_);
+		// Log lines are formatted by the caller, then written by a background thread, in batches that share one flock()
+		// of the master lockfile and one gathered write; without it, each line takes the lock and writes by itself
+	void flush(); // returns once everything logged so far has been written
 
 	int endLog(int returnCode = 0); // completes the log
 	void exitLog(int returnCode = 1) {
@@ -109,4 +259,35 @@ public:
 	} // convenience function
 };
 
+// Logging front end that filters by level before the comment is built. Levels below NGI_LOG_MIN_LEVEL compile to
+// nothing, and other levels cost one relaxed atomic load when filtered out at run time; in either case the
+// comment and arguments are not evaluated. With a crash ring, NGI_DEFERRED_LOG entries below the log level are kept
+// in it raw, and only formatted if it is dumped; NGI_LOG_DEBUG entries below the log level are not kept. E.g.:
+//	NGI_LOG_DEBUG(logger, "Cycle " + std::to_string(cycle) + " took " + std::to_string(us) + " us");
+//	NGI_DEFERRED_LOG(logger, Logger::_debug_, cycleFormat, cycle, us);
+#ifndef NGI_LOG_MIN_LEVEL
+	#ifdef NDEBUG
+		#define NGI_LOG_MIN_LEVEL 1 // Logger::_info_: debug statements are compiled out of release builds
+	#else
+		#define NGI_LOG_MIN_LEVEL 0 // Logger::_debug_
+	#endif
+#endif
+
+#define NGI_LOG_AT(logger, level, comment, alsoToMasterLog) \
+	do { \
+		if constexpr ((level) >= NGI_LOG_MIN_LEVEL) { \
+			if ((logger)->isLogged(level)) (logger)->addToLog((comment), (alsoToMasterLog), (level)); \
+		} \
+	} while (false)
+
+#define NGI_LOG_DEBUG(logger, comment) NGI_LOG_AT(logger, Logger::_debug_, comment, true)
+#define NGI_LOG_INFO(logger, comment) NGI_LOG_AT(logger, Logger::_info_, comment, true)
+
+#define NGI_DEFERRED_LOG(logger, level, format, ...) \
+	do { \
+		if constexpr ((level) >= NGI_LOG_MIN_LEVEL) { \
+			if ((logger)->isRecorded(level)) (logger)->deferredToLog((level), (format), __VA_ARGS__); \
+		} \
+	} while (false)
+
 #endif
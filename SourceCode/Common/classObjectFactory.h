@@ -1,8 +1,8 @@
 // classObjectFactory.h
-// Version 2021.11.27
+// Version 2026.10.16
 
 /*
-Copyright (c) 2014-2021, NeuroGadgets Inc.
+Copyright (c) 2014-2026, NeuroGadgets Inc.
 Author: Robert L. Charlebois
 All rights reserved.
 
@@ -35,9 +35,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define CLASS_GENERIC_OBJECT_FACTORY_H
 
 #include <functional>
+#include <iostream>
 #include <memory>
 #include <map>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 
 template<class T, typename... Args> class ObjectFactory {
 private:
@@ -66,10 +70,28 @@ public:
 };
 
 template<class T, typename... Args> class FunctionRegistry {
+public:
+	typedef std::function<T(Args&...)> Function;
 private:
-	std::map<std::string, std::function<T(Args&...)>> dispatch_;
-
-	FunctionRegistry() { }
+	struct Slot {
+		std::string key;
+		std::size_t hash;
+		Function f; // empty if the slot is unused
+	};
+	std::vector<Slot> slots_; // open addressing with linear probing; a power of two in size, at most half full
+	std::size_t numRegistered_;
+	bool frozen_;
+
+	FunctionRegistry() : slots_(16), numRegistered_(0), frozen_(false) { }
+	static std::size_t hashOf(std::string_view key) { return std::hash<std::string_view>()(key); }
+	std::size_t slotIndex(std::string_view key, std::size_t hash) const { // of key, or of the empty slot where it would go
+		const std::size_t mask = slots_.size() - 1;
+		std::size_t i = hash & mask;
+		while (slots_[i].f && (slots_[i].hash != hash || slots_[i].key != key)) {
+			i = (i + 1) & mask;
+		}
+		return i;
+	}
 public:
 	FunctionRegistry(const FunctionRegistry&) = delete;
 	FunctionRegistry& operator=(const FunctionRegistry&) = delete;
@@ -78,15 +100,46 @@ public:
 		static FunctionRegistry registry;
 		return registry;
 	}
-	bool Register(const std::string& key, std::function<T(Args&...)> f) {
-		return dispatch_.emplace(key, f).second; // once
+	bool Register(std::string_view key, Function f) { // false if f is empty, key is taken, or the registry is frozen
+		if (frozen_) { // Reported rather than thrown, as Register() is typically called from a static initializer
+			std::cerr << "FunctionRegistry::Register(), Error: cannot register " << key << " after the registry was frozen, e.g. by SocketServer::launchServer()." << std::endl;
+			return false;
+		}
+		if (!f) return false;
+		if (2 * (numRegistered_ + 1) > slots_.size()) { // Rehash into a table twice the size
+			std::vector<Slot> old(slots_.size() * 2);
+			old.swap(slots_);
+			for (auto& slot : old) {
+				if (slot.f) slots_[slotIndex(slot.key, slot.hash)] = std::move(slot);
+			}
+		}
+		const std::size_t hash = hashOf(key);
+		Slot& slot = slots_[slotIndex(key, hash)];
+		if (slot.f) return false; // once
+		slot = Slot{std::string(key), hash, std::move(f)};
+		++numRegistered_;
+		return true;
 	}
-	T operator()(const std::string& key, Args&... args) {
-		const auto& it = dispatch_.find(key);
-		if (it != dispatch_.end()) {
-			return it->second(args...);
+	void freeze() { frozen_ = true; } // e.g. once a server starts; lookups are then safe from any thread, and Register() fails
+	bool isFrozen() const { return frozen_; }
+	std::size_t size() const { return numRegistered_; }
+	template<class F> void forEachKey(F f) const { // f(std::string_view key), in no particular order
+		for (const auto& slot : slots_) {
+			if (slot.f) f(std::string_view(slot.key));
+		}
+	}
+
+	const Function* find(std::string_view key) const { // nullptr if not registered
+		const Slot& slot = slots_[slotIndex(key, hashOf(key))];
+		return slot.f ? &slot.f : nullptr;
+	}
+	bool isRegistered(std::string_view key) const { return find(key) != nullptr; }
+	T operator()(std::string_view key, Args&... args) const {
+		const Function* f = find(key);
+		if (f) {
+			return (*f)(args...);
 		} else {
-			throw std::runtime_error("FunctionRegistry::operator(), Error: function with key " + key + " not yet registered.");
+			throw std::runtime_error("FunctionRegistry::operator(), Error: function with key " + std::string(key) + " not yet registered.");
 		}
 	}
 };
@@ -116,6 +169,21 @@ std::string theFn(const std::string& arg)
 
 To use the function, e.g.
 std::cout << FunctionRegistry<std::string, const std::string&>::Instance()("myFn", "world") << std::endl;
+
+Functions taking a std::string_view are looked up and called without copying the key or the argument, e.g.
+
+namespace {
+	std::string theFn(std::string_view arg) { return "Hello " + std::string(arg); }
+	const bool registeredFn = FunctionRegistry<std::string, std::string_view>::Instance().Register("myFn", theFn);
+}
+
+std::string_view arg("world");
+std::cout << FunctionRegistry<std::string, std::string_view>::Instance()("myFn", arg) << std::endl;
+
+Registration is not thread-safe, so it should be done during static initialization or startup, after which the
+registry can be frozen with freeze(). SocketServer::launchServer() freezes the registries that it dispatches to, so
+functions registered later, e.g. by the static initializers of a library loaded with dlopen(), are rejected: Register()
+reports the error on std::cerr and returns false, and the function is never called.
 */
 
 #endif
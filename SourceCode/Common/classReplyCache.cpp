@@ -0,0 +1,126 @@
+// classReplyCache.cpp
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "classReplyCache.h"
+#include <algorithm>
+#include <iostream>
+
+std::string& ReplyCache::keyBuffer(std::string_view command, std::string_view argument)
+{ // Reused, so that a lookup does not allocate
+	thread_local std::string key;
+	key.assign(command);
+	key.push_back('\0');
+	key.append(argument);
+	return key;
+}
+
+bool ReplyCache::declareCacheable(std::string_view command, const Policy policy)
+{
+	if (frozen_) { // Reported rather than thrown, as for FunctionRegistry::Register()
+		std::cerr << "ReplyCache::declareCacheable(), Error: cannot declare " << command << " after the server was launched." << std::endl;
+		return false;
+	}
+	if (policy.timeToLive <= Clock::duration::zero() && !policy.untilNextEpoch) { // its replies would never expire
+		std::cerr << "ReplyCache::declareCacheable(), Error: " << command << " needs a time to live, or to expire with the epoch." << std::endl;
+		return false;
+	}
+	policies_.insert_or_assign(std::string(command), policy);
+	return true;
+}
+
+bool ReplyCache::setCapacity(const std::size_t maxEntries, const std::size_t maxEntryBytes)
+{ // The limits are read without locking, so they cannot change once the server is launched
+	if (frozen_) {
+		std::cerr << "ReplyCache::setCapacity(), Error: cannot change the capacity after the server was launched." << std::endl;
+		return false;
+	}
+	maxEntriesPerShard_ = std::max<std::size_t>(1, maxEntries / numShards);
+	maxEntryBytes_ = maxEntryBytes;
+	return true;
+}
+
+const ReplyCache::Policy* ReplyCache::policyOf(std::string_view command) const
+{
+	if (policies_.empty()) return nullptr;
+	const auto it = policies_.find(command);
+	return (it == policies_.end()) ? nullptr : &it->second;
+}
+
+ReplyCache::SharedReply ReplyCache::find(std::string_view command, std::string_view argument)
+{
+	if (argument.length() > maxEntryBytes_) return nullptr; // never cached
+	const std::string& key = keyBuffer(command, argument);
+	Shard& shard = shards_[std::hash<std::string_view>()(key) & (numShards - 1)];
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	const auto it = shard.index.find(key);
+	if (it == shard.index.end()) return nullptr;
+	const Entry& entry = *it->second;
+	if (entry.expiry <= Clock::now() || (entry.epoch != UINT64_MAX && entry.epoch != epoch())) {
+		const auto stale = it->second;
+		shard.index.erase(it); // first, as its key is a view of the entry's
+		shard.entries.erase(stale);
+		return nullptr;
+	}
+	shard.entries.splice(shard.entries.begin(), shard.entries, it->second); // most recently used
+	return entry.reply;
+}
+
+void ReplyCache::insert(const Policy& policy, std::string_view command, std::string_view argument, SharedReply reply, const std::uint64_t epochAtCall)
+{
+	if (policy.untilNextEpoch && epochAtCall != epoch()) return; // already stale
+	if (argument.length() > maxEntryBytes_ || reply->length() > maxEntryBytes_) return; // bounds the cache's memory
+	Entry entry{keyBuffer(command, argument), std::move(reply),
+		(policy.timeToLive > Clock::duration::zero()) ? Clock::now() + policy.timeToLive : Clock::time_point::max(),
+		policy.untilNextEpoch ? epochAtCall : UINT64_MAX};
+	Shard& shard = shards_[std::hash<std::string_view>()(entry.key) & (numShards - 1)];
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	const auto it = shard.index.find(entry.key);
+	if (it != shard.index.end()) { // computed concurrently by another session; keep the newer one
+		const auto older = it->second;
+		shard.index.erase(it); // first, as above
+		shard.entries.erase(older);
+	}
+	shard.entries.push_front(std::move(entry));
+	shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+	if (shard.entries.size() > maxEntriesPerShard_) { // evict the least recently used
+		shard.index.erase(shard.entries.back().key);
+		shard.entries.pop_back();
+	}
+}
+
+void ReplyCache::clear()
+{
+	for (auto& shard : shards_) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.index.clear();
+		shard.entries.clear();
+	}
+}
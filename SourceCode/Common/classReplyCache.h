@@ -0,0 +1,112 @@
+// classReplyCache.h
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// The response cache of SocketServer: replies to read-only commands, keyed by (command, argument), held in a sharded
+// LRU. A command is cacheable once declared, e.g. alongside its registration:
+//
+//	const bool registeredFn = FunctionRegistry<std::string, std::string_view>::Instance().Register("affect", theFn)
+//		&& ReplyCache::Instance().declareCacheable("affect", {std::chrono::milliseconds(250), false});
+//
+// Its replies are then reused until their time to live runs out, or, with untilNextEpoch, until advanceEpoch() is
+// called, e.g. by the Mind once per cycle. Error replies are never cached, nor are replies or arguments longer than
+// the cache's maximum entry size.
+
+#ifndef CLASS_REPLY_CACHE_H
+#define CLASS_REPLY_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class ReplyCache {
+public:
+	typedef std::shared_ptr<const std::string> SharedReply;
+	typedef std::chrono::steady_clock Clock;
+	struct Policy {
+		Clock::duration timeToLive; // zero: no time limit, which requires untilNextEpoch
+		bool untilNextEpoch; // invalidated by advanceEpoch()
+	};
+private:
+	struct Entry {
+		std::string key; // command, '\0', argument
+		SharedReply reply;
+		Clock::time_point expiry; // time_point::max() if none
+		std::uint64_t epoch; // of its computation, if it expires with the epoch; else UINT64_MAX
+	};
+	struct Shard {
+		std::mutex mutex;
+		std::list<Entry> entries; // most recently used first
+		std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // views of the entries' keys
+	};
+	static constexpr std::size_t numShards = 16; // a power of two
+
+	std::map<std::string, Policy, std::less<>> policies_;
+	std::array<Shard, numShards> shards_;
+	std::size_t maxEntriesPerShard_;
+	std::size_t maxEntryBytes_; // of an argument, or of a reply
+	std::atomic<std::uint64_t> epoch_;
+	bool frozen_;
+
+	ReplyCache() : maxEntriesPerShard_(256), maxEntryBytes_(65536), epoch_(0), frozen_(false) { }
+	static std::string& keyBuffer(std::string_view command, std::string_view argument); // thread_local
+public:
+	ReplyCache(const ReplyCache&) = delete;
+	ReplyCache& operator=(const ReplyCache&) = delete;
+
+	static ReplyCache& Instance() {
+		static ReplyCache cache;
+		return cache;
+	}
+	bool declareCacheable(std::string_view command, Policy policy); // for use in static registration; false once frozen
+	bool setCapacity(std::size_t maxEntries, std::size_t maxEntryBytes);
+		// 4096 entries by default, shared among the shards, of at most 64 KiB each; false once frozen
+	void freeze() { frozen_ = true; } // by SocketServer::launchServer(); policyOf() is then safe from any thread
+
+	const Policy* policyOf(std::string_view command) const; // nullptr if the command is not cacheable
+	std::uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+	void advanceEpoch() { epoch_.fetch_add(1, std::memory_order_acq_rel); } // cheap; stale entries are dropped when next looked up
+
+	SharedReply find(std::string_view command, std::string_view argument); // nullptr if absent or stale
+	void insert(const Policy& policy, std::string_view command, std::string_view argument, SharedReply reply, std::uint64_t epochAtCall);
+		// epochAtCall: epoch() from before the handler was called, so that a reply overlapping advanceEpoch() is stale
+	void clear();
+};
+
+#endif
@@ -1,8 +1,8 @@
 // classSocketClient.cpp
-// Version 2021.12.24
+// Version 2026.10.16
 
 /*
-Copyright (c) 2014-2021, NeuroGadgets Inc.
+Copyright (c) 2014-2026, NeuroGadgets Inc.
 Author: Robert L. Charlebois
 All rights reserved.
 
@@ -36,20 +36,26 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <sstream>
 #include <sys/stat.h>
 
-bool SocketClient::connect(const std::string& hostname, const std::string& port)
+bool SocketClient::connect(const std::string& hostname, const std::string& port, const Wire wire)
 {
 	using boost::asio::ip::tcp;
 	try {
 		tcp::resolver resolver_(io_service_);
 		tcp::resolver::query q(tcp::v4(), hostname, port);
-		tcp::resolver::iterator i(resolver_.resolve(q));
-		boost::asio::connect(socket_, i);
+		boost::system::error_code error(boost::asio::error::host_not_found);
+		for (tcp::resolver::iterator i(resolver_.resolve(q)); error && i != tcp::resolver::iterator(); ++i) {
+			socket_.close();
+			socket_.connect(boost::asio::generic::stream_protocol::endpoint(i->endpoint()), error);
+		}
+		if (error) {
+			throw boost::system::system_error(error);
+		}
         hostname_ = hostname;
         portString_ = port;
 		isLocalHost_ = (hostname == "localhost");
 		// We need to authenticate by proving that we can retrieve a file from the server that is only
 		// readable by the user owning that file:
-		const std::string remoteFileToRetrieve(retrieveString("AuthStep1", "please"));
+		const std::string remoteFileToRetrieve(retrieveString("AuthStep1", wire == Wire::framed ? SocketFrame::negotiationString : "please"));
 		const std::string::size_type slashPos = remoteFileToRetrieve.find_last_of('/');
 		if (slashPos == std::string::npos) {
 			throw std::runtime_error("SocketClient::connect(), bad authorization command retrieved from server");
@@ -64,9 +70,13 @@ bool SocketClient::connect(const std::string& hostname, const std::string& port)
 		authFile >> authString;
 		authFile.close();
 		std::remove(auth1filename.c_str());
-		if (retrieveString("AuthStep2", authString) != "ok") {
+		const std::string authResult(retrieveString("AuthStep2", authString));
+		if (authResult != "ok" && authResult != SocketFrame::negotiationString) {
 			throw std::runtime_error("SocketClient::connect(), could not authorize connection.");
 		}
+		isFramed_ = (authResult == SocketFrame::negotiationString); // older servers answer "ok", and stay with text
+		commandIDs_.clear();
+		nextRequestID_ = 0;
 		isConnected_ = true;
 	} catch (std::exception& e) {
 		disconnect();
@@ -78,10 +88,35 @@ bool SocketClient::connect(const std::string& hostname, const std::string& port)
 	return isConnected_;
 }
 
+bool SocketClient::connectLocal(const std::string& socketPath, const Wire wire)
+{
+	try {
+		socket_.connect(boost::asio::generic::stream_protocol::endpoint(boost::asio::local::stream_protocol::endpoint(socketPath)));
+		hostname_ = "localhost";
+		portString_ = socketPath;
+		isLocalHost_ = true;
+		// The server checks that we are the same user from the socket's peer credentials, so no file round trip is needed:
+		const std::string authResult(retrieveString("AuthPeer", wire == Wire::framed ? SocketFrame::negotiationString : "please"));
+		if (authResult != "ok" && authResult != SocketFrame::negotiationString) {
+			throw std::runtime_error("SocketClient::connectLocal(), could not authorize connection.");
+		}
+		isFramed_ = (authResult == SocketFrame::negotiationString);
+		commandIDs_.clear();
+		nextRequestID_ = 0;
+		isConnected_ = true;
+	} catch (...) {
+		disconnect();
+		throw;
+	}
+	return isConnected_;
+}
+
 void SocketClient::disconnect()
 {
 	socket_.close();
+	lineBuffer_.consume(lineBuffer_.size());
 	isConnected_ = false;
+	isFramed_ = false;
 }
 
 void SocketClient::sendFiles(const std::vector<std::string>& localFileNames, std::string localSourceFolder, std::string remoteDestinationFolder)
@@ -135,17 +170,140 @@ void SocketClient::retrieveFiles(const std::vector<std::string>& remoteFileNames
 }
 
 
+void SocketClient::sendFrame(const std::string& command, const std::string& argument, const std::uint16_t flags, const std::uint32_t requestID)
+{
+	const bool tagged = (flags & SocketFrame::_tagged_);
+	if (argument.length() > SocketFrame::maxPayloadLength - (tagged ? sizeof(requestID) : 0)) {
+		throw std::runtime_error("SocketClient::sendFrame(), argument too long for a frame");
+	}
+	std::vector<boost::asio::const_buffer> buffers;
+	std::string definitionHeader;
+	auto id = commandIDs_.find(command);
+	if (id == commandIDs_.end()) { // Define it, in the same write as the request
+		if (commandIDs_.size() > UINT16_MAX) {
+			throw std::runtime_error("SocketClient::sendFrame(), too many distinct commands for a framed connection");
+		}
+		id = commandIDs_.emplace(command, static_cast<std::uint16_t>(commandIDs_.size())).first;
+		definitionHeader = SocketFrame{static_cast<std::uint32_t>(command.length()), id->second, SocketFrame::_defineCommand_}.header();
+		buffers.push_back(boost::asio::buffer(definitionHeader));
+		buffers.push_back(boost::asio::buffer(command));
+	}
+	std::string header(SocketFrame{static_cast<std::uint32_t>(argument.length() + (tagged ? sizeof(requestID) : 0)), id->second, flags}.header());
+	if (tagged) {
+		const std::uint32_t networkID = htonl(requestID);
+		header.append(reinterpret_cast<const char*>(&networkID), sizeof(networkID));
+	}
+	buffers.push_back(boost::asio::buffer(header));
+	buffers.push_back(boost::asio::buffer(argument));
+	boost::asio::write(socket_, buffers);
+}
+
 void SocketClient::sendCommandAndString(const std::string& command, const std::string& argument)
 {
+	if (isFramed_) {
+		sendFrame(command, argument, 0, 0);
+		return;
+	}
 	const std::string cs(command + commandFieldSeparator_ + argument + '\n');
     boost::asio::write(socket_, boost::asio::buffer(cs.c_str(), cs.length()));
 }
 
+std::uint32_t SocketClient::sendTaggedCommand(const std::string& command, const std::string& argument)
+{
+	if (!isFramed_) {
+		throw std::runtime_error("SocketClient::sendTaggedCommand(), requires a framed connection");
+	}
+	const std::uint32_t requestID = nextRequestID_++;
+	sendFrame(command, argument, SocketFrame::_tagged_, requestID);
+	return requestID;
+}
+
+void SocketClient::subscribe(const std::string& topic, const double maxUpdatesPerSecond)
+{
+	sendCommandAndString("Subscribe", (maxUpdatesPerSecond > 0) ? topic + argumentFieldSeparator_ + std::to_string(maxUpdatesPerSecond) : topic);
+	std::pair<std::string, std::string> message;
+	while (receivePushOrReply(message)) { // to topics subscribed earlier
+		pushes_.push_back(std::move(message));
+	}
+	if (message.first != "Subscribe" || message.second != "ok") {
+		throw std::runtime_error("Request \"Subscribe " + topic + "\" returned: " + message.second);
+	}
+}
+
+std::pair<std::string, std::string> SocketClient::receivePush()
+{
+	std::pair<std::string, std::string> message;
+	if (!pushes_.empty()) {
+		message = std::move(pushes_.front());
+		pushes_.pop_front();
+	} else if (!receivePushOrReply(message)) {
+		throw std::runtime_error("Error: SocketClient::receivePush() received the reply to " + message.first + ": " + message.second);
+	}
+	return message;
+}
+
+bool SocketClient::receivePushOrReply(std::pair<std::string, std::string>& message)
+{
+	if (isFramed_) {
+		char headerBytes[SocketFrame::headerLength];
+		boost::asio::read(socket_, boost::asio::buffer(headerBytes));
+		const SocketFrame frame(SocketFrame::fromHeader(headerBytes));
+		if (frame.payloadLength > SocketFrame::maxPayloadLength) {
+			throw std::runtime_error("Error: SocketClient::receivePushOrReply() received a corrupt frame");
+		}
+		std::string payload(frame.payloadLength, '\0');
+		boost::asio::read(socket_, boost::asio::buffer(payload));
+		if (frame.flags & SocketFrame::_error_) {
+			throw std::runtime_error("Error: " + payload);
+		}
+		if (frame.flags & SocketFrame::_push_) {
+			const std::string::size_type p = payload.find('\0');
+			message.first = payload.substr(0, p);
+			message.second = (p == std::string::npos) ? std::string() : payload.substr(p + 1);
+			return true;
+		}
+		message.first.clear();
+		for (const auto& id : commandIDs_) {
+			if (id.second == frame.commandID) message.first = id.first;
+		}
+		message.second = std::move(payload);
+		return false;
+	}
+	const std::string receivedString(receiveString()); // throws on "Error:"
+	const std::string::size_type p = receivedString.find(receiveStringFieldSeparator_);
+	if (p == std::string::npos) {
+		throw std::runtime_error("Error: SocketClient::receivePushOrReply() received " + receivedString);
+	}
+	message.first = receivedString.substr(0, p);
+	message.second = receivedString.substr(p + receiveStringFieldSeparator_.length());
+	return message.first != "Subscribe"; // a reserved command, so not a topic name
+}
+
+SocketClient::TaggedReply SocketClient::receiveTaggedReply()
+{
+	char headerBytes[SocketFrame::headerLength];
+	boost::asio::read(socket_, boost::asio::buffer(headerBytes));
+	const SocketFrame reply(SocketFrame::fromHeader(headerBytes));
+	if (reply.payloadLength > SocketFrame::maxPayloadLength || !(reply.flags & SocketFrame::_tagged_) || reply.payloadLength < sizeof(std::uint32_t)) {
+		throw std::runtime_error("Error: SocketClient::receiveTaggedReply() received an untagged or corrupt frame");
+	}
+	std::uint32_t networkID;
+	boost::asio::read(socket_, boost::asio::buffer(&networkID, sizeof(networkID)));
+	TaggedReply tagged{ntohl(networkID), std::string(), std::string(reply.payloadLength - sizeof(networkID), '\0'), (reply.flags & SocketFrame::_error_) != 0};
+	boost::asio::read(socket_, boost::asio::buffer(tagged.payload));
+	for (const auto& id : commandIDs_) {
+		if (id.second == reply.commandID) {
+			tagged.command = id.first;
+			break;
+		}
+	}
+	return tagged;
+}
+
 std::string SocketClient::receiveString()
 {
-	boost::asio::streambuf b;
-    boost::asio::read_until(socket_, b, '\n');
-	std::istream is(&b);
+    boost::asio::read_until(socket_, lineBuffer_, '\n');
+	std::istream is(&lineBuffer_);
 	std::string theString;
 	std::getline(is, theString);
 	if (theString.find("Error:") != std::string::npos) { // Assumes that SocketServer recognizes this specific "Error:" string
@@ -154,8 +312,29 @@ std::string SocketClient::receiveString()
 	return theString;
 }
 
+std::string SocketClient::receiveFrame(const std::string& command)
+{
+	char headerBytes[SocketFrame::headerLength];
+	boost::asio::read(socket_, boost::asio::buffer(headerBytes));
+	const SocketFrame reply(SocketFrame::fromHeader(headerBytes));
+	if (reply.payloadLength > SocketFrame::maxPayloadLength) {
+		throw std::runtime_error("Error: SocketClient::receiveFrame(" + command + ") received a corrupt frame");
+	}
+	std::string payload(reply.payloadLength, '\0');
+	boost::asio::read(socket_, boost::asio::buffer(payload));
+	if (reply.flags & SocketFrame::_error_) {
+		throw std::runtime_error(command + receiveStringFieldSeparator_ + "Error: " + payload); // as in text mode
+	}
+	const auto id = commandIDs_.find(command);
+	if (id == commandIDs_.end() || id->second != reply.commandID) {
+		throw std::runtime_error("Error: SocketClient::receiveFrame(" + command + ") received the reply to command ID " + std::to_string(reply.commandID));
+	}
+	return payload;
+}
+
 std::string SocketClient::receiveString(const std::string& tag)
 {
+	if (isFramed_) return receiveFrame(tag);
 	const std::string receivedString(receiveString());
 	const std::string::size_type p = receivedString.find(receiveStringFieldSeparator_);
 	if (p == std::string::npos || receivedString.substr(0, p) != tag) {
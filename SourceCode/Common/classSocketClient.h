@@ -1,8 +1,8 @@
 // classSocketClient.h
-// Version 2021.12.24
+// Version 2026.10.16
 
 /*
-Copyright (c) 2014-2021, NeuroGadgets Inc.
+Copyright (c) 2014-2026, NeuroGadgets Inc.
 Author: Robert L. Charlebois
 All rights reserved.
 
@@ -32,32 +32,50 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef CLASS_REMOTE_DAEMON_CLIENT_H
 #define CLASS_REMOTE_DAEMON_CLIENT_H
 
+#include "classSocketFrame.h"
 #include "ngiAlgorithms.h"
 #include "tupleStringStreamer.h"
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
 #include <string>
+#include <type_traits>
 #include <boost/asio.hpp>
 
 class SocketClient {
 private:
 	boost::asio::io_service io_service_;
-	boost::asio::ip::tcp::socket socket_;
+	boost::asio::generic::stream_protocol::socket socket_; // TCP, or AF_UNIX after connectLocal()
     std::string hostname_;
     std::string portString_;
 	std::string commandFieldSeparator_;
 	std::string receiveStringFieldSeparator_;
 	std::string argumentFieldSeparator_;
+	boost::asio::streambuf lineBuffer_; // in text mode; a read may pick up more than one line, e.g. several pushes
+	std::map<std::string, std::uint16_t> commandIDs_; // in framed mode, as defined to the server
+	std::uint32_t nextRequestID_; // for tagged frames
+	std::deque<std::pair<std::string, std::string>> pushes_; // (topic, value), received while waiting for a Subscribe reply
 	std::string receiveString();
 	std::string receiveString(const std::string& tag);
+	void sendFrame(const std::string& command, const std::string& argument, std::uint16_t flags, std::uint32_t requestID);
+	std::string receiveFrame(const std::string& command);
+	bool receivePushOrReply(std::pair<std::string, std::string>& message); // true for a push, else (command, reply)
 	bool isConnected_;
 	bool isLocalHost_;
+	bool isFramed_;
 public:
+	enum class Wire { text, framed }; // framed: length-prefixed frames, if the server supports them (see classSocketFrame.h)
+
 	SocketClient(const std::string& cmdFieldSeparator = "__+__", const std::string& receivedStrFieldSeparator = "__$__", const std::string& argFieldSeparator = "__*__") :
 		socket_(io_service_),
 		commandFieldSeparator_(cmdFieldSeparator),
 		receiveStringFieldSeparator_(receivedStrFieldSeparator),
 		argumentFieldSeparator_(argFieldSeparator),
+		nextRequestID_(0),
 		isConnected_(false),
-		isLocalHost_(false)
+		isLocalHost_(false),
+		isFramed_(false)
 		{ }
 	SocketClient(const SocketClient&) = delete;
 	SocketClient& operator=(const SocketClient&) = delete;
@@ -70,11 +88,14 @@ public:
 	const std::string& itsPort() const { return portString_; }
 	const std::string& itsArgumentFieldSeparator() const { return argumentFieldSeparator_; }
 	bool isConnected() const { return isConnected_; }
+	bool isFramed() const { return isFramed_; } // false if framing was not requested, or the server does not support it
 
-	bool connect(const std::string& hostname, const std::string& port);
-	bool connect(const std::pair<std::string, std::string>& p) {
-		return connect(p.first, p.second);
+	bool connect(const std::string& hostname, const std::string& port, Wire wire = Wire::text);
+	bool connect(const std::pair<std::string, std::string>& p, Wire wire = Wire::text) {
+		return connect(p.first, p.second, wire);
 	}
+	bool connectLocal(const std::string& socketPath, Wire wire = Wire::text);
+		// To a SocketServer on this host that called listenOnUnixSocket(socketPath); authenticates in one round trip
 	void disconnect();
 	
 	void sendFiles(const std::vector<std::string>& localFileNames, std::string localSourceFolder, std::string remoteDestinationFolder);
@@ -82,6 +103,21 @@ public:
 
 	void sendCommandAndString(const std::string& command, const std::string& argument); // No return value
 
+	struct TaggedReply {
+		std::uint32_t requestID;
+		std::string command;
+		std::string payload; // or the error message
+		bool isError;
+	};
+	std::uint32_t sendTaggedCommand(const std::string& command, const std::string& argument);
+		// Framed mode only: returns the ID that its reply will carry. Replies to the server's offloaded handlers
+		// arrive as they complete, so several tagged requests can be sent before calling receiveTaggedReply().
+	TaggedReply receiveTaggedReply();
+
+	void subscribe(const std::string& topic, double maxUpdatesPerSecond = 0); // 0: as often as the topic is published
+		// The server then pushes the topic's values to this connection, which should be dedicated to subscriptions
+	std::pair<std::string, std::string> receivePush(); // (topic, value); blocks until the next one
+
 	std::string retrieveString(const std::string& command, const std::string& argument, const std::string& expectedResponse = std::string()); // Can include whitespace
 	
 	template<typename R> R retrieveSingleValue(const std::string& command, const std::string& argument)
@@ -109,6 +145,28 @@ public:
 		}
 		return values;
 	} // Call as e.g. retrieveValueVector<double>(command, argument, 12);
+
+	template<typename R> std::vector<R> retrieveRawValueVector(const std::string& command, const std::string& argument)
+	{ // Framed mode only: the reply holds the values' bytes, as built by e.g. rawValueString(values) on the same architecture
+		static_assert(std::is_trivially_copyable<R>::value, "retrieveRawValueVector(): type must be trivially copyable");
+		if (!isFramed_) {
+			throw std::runtime_error("SocketClient::retrieveRawValueVector(), requires a framed connection");
+		}
+		sendCommandAndString(command, argument);
+		const std::string payload(receiveString(command));
+		if (payload.length() % sizeof(R) != 0) {
+			throw std::runtime_error("SocketClient::retrieveRawValueVector(), received " + std::to_string(payload.length()) + " bytes, not a multiple of " + std::to_string(sizeof(R)));
+		}
+		std::vector<R> values(payload.length() / sizeof(R));
+		std::memcpy(values.data(), payload.data(), payload.length());
+		return values;
+	}
 };
 
+template<typename T> std::string rawValueString(const std::vector<T>& values)
+{ // For a SocketServer handler replying to retrieveRawValueVector<T>()
+	static_assert(std::is_trivially_copyable<T>::value, "rawValueString(): type must be trivially copyable");
+	return std::string(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
 #endif
@@ -0,0 +1,85 @@
+// classSocketFrame.h
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Length-prefixed frames: the optional binary wire mode of SocketServer and SocketClient. The client asks for it
+// with AuthStep1__+__framed (rather than AuthStep1__+__please), and a server that supports it answers AuthStep2
+// with "framed" instead of "ok". From then on, each request and each reply is a frame, and payloads are opaque:
+// they may contain newlines, separators, or raw numeric arrays.
+//
+// Frame layout (network byte order):
+//	u32 payload length, u16 command ID, u16 flags, then the payload
+// Command IDs are chosen by the client, per connection; a _defineCommand_ frame, whose payload is the command
+// name, precedes the first use of each ID and has no reply. A reply carries the command ID of its request,
+// and _error_ if its payload is an error message.
+// A _tagged_ request's payload starts with a u32 request ID chosen by the client, and so does its reply's; a tagged
+// reply may overtake the replies to earlier requests, if its handler is offloaded. Untagged replies keep request order.
+// A _push_ frame is an update to a subscribed topic: it carries the command ID of the Subscribe request, and its
+// payload is the topic name, '\0', then the value.
+
+#ifndef CLASS_SOCKET_FRAME_H
+#define CLASS_SOCKET_FRAME_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <arpa/inet.h>
+
+struct SocketFrame {
+	static constexpr std::size_t headerLength = 8;
+	static constexpr std::uint32_t maxPayloadLength = 1U << 30; // a larger length means a corrupt stream
+	static constexpr char negotiationString[] = "framed";
+	enum : std::uint16_t { _defineCommand_ = 1, _error_ = 2, _tagged_ = 4, _push_ = 8 };
+
+	std::uint32_t payloadLength;
+	std::uint16_t commandID;
+	std::uint16_t flags;
+
+	std::string header() const {
+		std::string h(headerLength, '\0');
+		const std::uint32_t length = htonl(payloadLength);
+		const std::uint16_t id = htons(commandID);
+		const std::uint16_t f = htons(flags);
+		h.replace(0, 4, reinterpret_cast<const char*>(&length), 4);
+		h.replace(4, 2, reinterpret_cast<const char*>(&id), 2);
+		h.replace(6, 2, reinterpret_cast<const char*>(&f), 2);
+		return h;
+	}
+	static SocketFrame fromHeader(const char* h) { // h holds headerLength bytes
+		std::uint32_t length;
+		std::uint16_t id, f;
+		std::memcpy(&length, h, 4);
+		std::memcpy(&id, h + 4, 2);
+		std::memcpy(&f, h + 6, 2);
+		return SocketFrame{ntohl(length), ntohs(id), ntohs(f)};
+	}
+};
+
+#endif
@@ -1,8 +1,8 @@
 // classSocketServer.cpp
-// Version 2021.12.24
+// Version 2026.10.16
 
 /*
-Copyright (c) 2014-2021, NeuroGadgets Inc.
+Copyright (c) 2014-2026, NeuroGadgets Inc.
 Author: Robert L. Charlebois
 All rights reserved.
 
@@ -33,67 +33,1104 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ngiAlgorithms.h"
 #include "ngiFileUtilities.h"
 #include "randomNumberGenerators.h"
+#include "classCommandStats.h"
+#include "classHTTPParser.h"
 #include "classObjectFactory.h"
+#include "classReplyCache.h"
+#include "classSocketFrame.h"
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <exception>
 #include <fstream>
+#include <iterator>
+#include <optional>
 #include <thread>
+#include <utility>
+#include <arpa/inet.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
-char translateHex(char hex)
-{ // Translate a single hex character; used by decodeURLString()
-	return (hex >= 'A') ? (hex & 0xdf) - 'A' + 10 : hex - '0';
+typedef std::map<std::string, std::string> CGImap; // for the web handlers that take a copy of the fields
+
+typedef std::shared_ptr<boost::asio::generic::stream_protocol::socket> Socket_ptr;
+
+bool peerCredentials(boost::asio::generic::stream_protocol::socket& sock, ucred* credentials)
+{ // AF_UNIX only
+	socklen_t length = sizeof(*credentials);
+	return getsockopt(sock.native_handle(), SOL_SOCKET, SO_PEERCRED, credentials, &length) == 0;
+}
+
+std::string describePeer(boost::asio::generic::stream_protocol::socket& sock)
+{
+	boost::system::error_code error;
+	const auto endpoint(sock.remote_endpoint(error));
+	if (error) return "an unknown address";
+	char text[INET6_ADDRSTRLEN] = "";
+	switch (endpoint.data()->sa_family) {
+		case AF_INET:
+			inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(endpoint.data())->sin_addr, text, sizeof(text));
+			return text;
+		case AF_INET6:
+			inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(endpoint.data())->sin6_addr, text, sizeof(text));
+			return text;
+		case AF_UNIX: {
+			ucred credentials;
+			return peerCredentials(sock, &credentials) ? "local process " + std::to_string(credentials.pid) : "a local process";
+		}
+		default:
+			return "an unknown address";
+	}
+}
+
+std::string escapeHTML(std::string_view text)
+{ // For text that the client controls, e.g. an error message quoting its request
+	std::string escaped;
+	escaped.reserve(text.length());
+	for (const char c : text) {
+		switch (c) {
+			case '&': escaped += "&amp;"; break;
+			case '<': escaped += "&lt;"; break;
+			case '>': escaped += "&gt;"; break;
+			case '"': escaped += "&quot;"; break;
+			case '\'': escaped += "&#39;"; break;
+			default: escaped += c;
+		}
+	}
+	return escaped;
+}
+
+std::string httpResponseHead(const unsigned status, const std::size_t contentLength, const bool keepAlive)
+{
+	const char* reason;
+	switch (status) {
+		case 200: reason = "OK"; break;
+		case 400: reason = "Bad Request"; break;
+		case 403: reason = "Forbidden"; break;
+		case 404: reason = "Not Found"; break;
+		case 413: reason = "Payload Too Large"; break;
+		case 431: reason = "Request Header Fields Too Large"; break;
+		case 501: reason = "Not Implemented"; break;
+		case 505: reason = "HTTP Version Not Supported"; break;
+		default: reason = "Internal Server Error";
+	}
+	return "HTTP/1.1 " + std::to_string(status) + ' ' + reason + "\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: " + std::to_string(contentLength)
+		+ "\r\nCache-Control: no-store\r\nConnection: " + (keepAlive ? "keep-alive" : "close") + "\r\n\r\n";
+}
+
+const std::string newline("\n");
+const std::string statsCommand("Stats"); // reserved, for text, framed and web requests
+const std::string subscribeCommand("Subscribe"); // reserved, for text and framed requests
+const double minUpdatesPerSecond = 1e-3; // of a rate-limited subscription; a lower rate would overflow its interval
+
+SocketServer::SharedReply callHandler(std::string_view command, std::string_view argument)
+{ // Handlers taking a std::string_view are looked up and called without copying; a SharedReply is sent without copying
+	if (const auto* f = FunctionRegistry<SocketServer::SharedReply, std::string_view>::Instance().find(command)) {
+		SocketServer::SharedReply reply((*f)(argument));
+		return reply ? reply : std::make_shared<const std::string>();
+	}
+	if (const auto* f = FunctionRegistry<std::string, std::string_view>::Instance().find(command)) {
+		return std::make_shared<const std::string>((*f)(argument)); // moved, not copied
+	}
+	const std::string argumentString(argument);
+	return std::make_shared<const std::string>(FunctionRegistry<std::string, const std::string&>::Instance()(command, argumentString));
+}
+
+SocketServer::SharedReply dispatchCommand(std::string_view command, std::string_view argument, bool& fromCache)
+{ // Repeated requests for a cacheable command are answered from the ReplyCache, without calling its handler
+	ReplyCache& cache = ReplyCache::Instance();
+	const ReplyCache::Policy* policy = cache.policyOf(command);
+	if (!policy) return callHandler(command, argument);
+	if (SocketServer::SharedReply cached = cache.find(command, argument)) {
+		fromCache = true;
+		return cached;
+	}
+	const std::uint64_t epoch = cache.epoch();
+	SocketServer::SharedReply reply(callHandler(command, argument)); // throws rather than caching an error
+	cache.insert(*policy, command, argument, reply, epoch);
+	return reply;
+}
+
+class SocketServer::Topic {
+public:
+	std::mutex mutex;
+	SharedReply latest;
+	std::uint64_t version = 0; // of latest; 0 until the first publish()
+	std::vector<std::weak_ptr<Subscription>> subscriptions;
+};
+
+struct SocketServer::Subscription : public std::enable_shared_from_this<SocketServer::Subscription> {
+	std::weak_ptr<Session> session;
+	std::shared_ptr<Topic> topic;
+	std::string topicName;
+	std::uint16_t commandID; // of the Subscribe frame, in framed mode
+	std::chrono::steady_clock::duration minInterval; // between pushes
+	std::chrono::steady_clock::time_point lastPush;
+	std::uint64_t pushedVersion = 0;
+	std::atomic<bool> notified{false}; // a delivery is posted to the session's strand
+	bool awaitingWrite = false; // delivered by the write in progress, once it completes
+	boost::asio::steady_timer timer; // armed while the rate limit defers a push
+	bool timerArmed = false;
+
+	explicit Subscription(const boost::asio::any_io_executor& executor) : timer(executor) { } // the session's
+	void notify(); // from any thread
+};
+
+bool isWebCommand(std::string_view command)
+{
+	return FunctionRegistry<SocketServer::SharedReply, const CGIViewMap&>::Instance().isRegistered(command)
+		|| FunctionRegistry<std::string, const CGIViewMap&>::Instance().isRegistered(command)
+		|| FunctionRegistry<SocketServer::SharedReply, const CGImap&>::Instance().isRegistered(command)
+		|| FunctionRegistry<std::string, const CGImap&>::Instance().isRegistered(command);
+}
+
+SocketServer::SharedReply dispatchWebCommand(std::string_view command, const CGIViewMap& fields)
+{ // Handlers taking a CGIViewMap read the decoded fields in place; the others get a CGImap of copies
+	if (const auto* f = FunctionRegistry<SocketServer::SharedReply, const CGIViewMap&>::Instance().find(command)) {
+		SocketServer::SharedReply reply((*f)(fields));
+		return reply ? reply : std::make_shared<const std::string>();
+	}
+	if (const auto* f = FunctionRegistry<std::string, const CGIViewMap&>::Instance().find(command)) {
+		return std::make_shared<const std::string>((*f)(fields));
+	}
+	CGImap cgim;
+	for (std::size_t i = 0; i < fields.size(); ++i) { // a later field overrides an earlier one of the same name
+		cgim.insert_or_assign(std::string(fields[i].first), std::string(fields[i].second));
+	}
+	if (const auto* f = FunctionRegistry<SocketServer::SharedReply, const CGImap&>::Instance().find(command)) {
+		SocketServer::SharedReply reply((*f)(cgim));
+		return reply ? reply : std::make_shared<const std::string>();
+	}
+	return std::make_shared<const std::string>(FunctionRegistry<std::string, const CGImap&>::Instance()(command, cgim));
+}
+
+
+typedef FunctionRegistry<void, std::string_view, const SocketServer::Completion&> OffloadedHandlers;
+
+
+class SocketServer::Session : public std::enable_shared_from_this<SocketServer::Session> {
+public:
+	struct Offloaded { // shared by the copies of an offloaded handler's Completion
+		std::mutex mutex; // held while it completes
+		std::shared_ptr<Session> session; // until it completes, or the server is destroyed; later calls do nothing
+		std::chrono::steady_clock::time_point arrival, started;
+	};
+private:
+	struct Reply { // its pieces are sent as part of one gathered write, with those of the other ready replies
+		std::vector<boost::asio::const_buffer> pieces;
+		std::vector<SharedReply> keepAlive; // the pieces that are not the server's own strings
+		bool ready = true; // false until its offloaded handler completes
+	};
+	typedef std::function<void(Session&, Reply&, SharedReply, bool)> ReplyFormatter; // (session, reply, payload, isError)
+
+	SocketServer* server_; // non-owning; outlives its sessions, whose handlers are destroyed with the io_service of their socket
+	Socket_ptr sock_;
+	boost::asio::strand<boost::asio::any_io_executor> strand_; // runs this session's handlers, and the completions of its offloaded handlers, one at a time
+	boost::asio::streambuf buffer_; // persists for the session, as a read may pick up several pipelined requests
+	boost::asio::steady_timer deadline_; // closes the session unless the next read completes first
+	std::deque<Reply> replies_; // in request order; pointers to its elements stay valid while the handlers complete
+	std::deque<Reply> taggedReplies_; // to tagged frames, and pushes, sent as soon as they are ready, whatever their order
+	std::map<std::string, std::shared_ptr<Subscription>, std::less<>> subscriptions_;
+	std::vector<boost::asio::const_buffer> outgoing_; // being written
+	std::vector<SharedReply> outgoingKeepAlive_;
+	bool writing_;
+	bool endSession_; // once all the replies have been written
+	// Note: for non-HTTP requests, the first requests need to be about authentication, to verify that the client user is the server user.
+	std::string sessionAuthorizationFile_, sessionAuthorizationStr_;
+	std::uint64_t authenticationStep_;
+	bool peerAuthenticated_; // a local process running as this user, which may use AuthPeer instead of AuthStep1 and AuthStep2
+	bool framingRequested_; // by AuthStep1
+	bool framed_; // length-prefixed frames (see classSocketFrame.h) rather than lines, once authenticated
+	std::vector<std::string> commandNames_; // indexed by the client's command IDs, in framed mode
+	bool http_; // web requests, from a browser or the like, once the first line was an HTTP request line
+	HTTPParser httpParser_;
+	CGIViewMap webFields_; // of the HTTP request being answered; reused, with its storage
+	std::chrono::steady_clock::time_point arrival_; // of the requests being processed
+	std::size_t taggedInFlight_; // offloaded handlers running for tagged frames, whose replies have no slot in replies_
+	bool readPaused_; // at the in-flight or queued-bytes limit; the buffered requests wait, and the client's writes back up
+	std::mutex offloadedMutex_; // offloaded_ is also read by the server's destructor
+	std::vector<std::weak_ptr<Offloaded>> offloaded_; // handlers that may not have completed yet
+
+	template<class Handler> auto onStrand(Handler&& h) { return boost::asio::bind_executor(strand_, std::forward<Handler>(h)); }
+	bool hasBufferedLine() const;
+	std::size_t nextFrameLength() const; // headerLength while the header is incomplete
+	bool hasBufferedRequest() const;
+	void processFrame();
+	void readRequest();
+	void handleRequest(const boost::system::error_code& error);
+	void processBufferedRequests();
+	bool atInFlightLimit() const {
+		return server_->maxInFlightPerSession_ > 0 && replies_.size() + taggedInFlight_ >= server_->maxInFlightPerSession_;
+	}
+	std::size_t queuedBytes() const; // of the replies not yet written
+	bool overLimits() const {
+		return atInFlightLimit() || (server_->maxQueuedBytesPerSession_ > 0 && queuedBytes() >= server_->maxQueuedBytesPerSession_);
+	}
+	void resumeReading(); // if paused, and back under the limits
+	void processRequest(const std::string& theString);
+	void processHTTPRequests(); // feeds buffer_ to httpParser_, answering each complete request
+	void answerHTTPRequest(const HTTPParser::Request& request);
+	SharedReply replyToCommand(const std::string& command, const std::string& theString, std::string::size_type p);
+	SharedReply runCommand(std::string_view command, std::string_view argument, std::uint16_t commandID = 0); // dispatchCommand(), recording its statistics
+	bool isOffloaded(std::string_view command) const {
+		return command != statsCommand && command != subscribeCommand && OffloadedHandlers::Instance().isRegistered(command);
+	}
+	SharedReply subscribe(std::string_view argument, std::uint16_t commandID); // to topic or topic__*__maxUpdatesPerSecond
+	void addPush(Subscription& s, SharedReply value);
+	void offload(const OffloadedHandlers::Function& handler, std::string_view command, std::string_view argument, Reply* slot, ReplyFormatter format);
+		// Runs handler on the server's worker pool, unless its reply is cached; format fills in slot once it completes,
+		// or a tagged reply if slot is nullptr
+	void complete(Reply* slot, const ReplyFormatter& format, SharedReply payload, bool isError); // then writes
+	void fill(Reply* slot, const ReplyFormatter& format, SharedReply payload, bool isError);
+	static void addLastingPiece(Reply& r, const std::string& s) { // s outlives the write, e.g. the server's separators
+		if (!s.empty()) r.pieces.push_back(boost::asio::buffer(s));
+	}
+	static void addSharedPiece(Reply& r, SharedReply s) {
+		r.keepAlive.push_back(std::move(s));
+		addLastingPiece(r, *r.keepAlive.back());
+	}
+	void addTextReply(Reply& r, std::string&& command, SharedReply payload); // {command, separator, payload, "\n"}
+	static void addFrameReply(Reply& r, std::uint16_t commandID, std::uint16_t flags, std::uint32_t requestID, SharedReply payload); // {header, [request ID], payload}
+	void addHTMLReply(Reply& r, SharedReply body, std::string_view title); // {htmlHeader_, body, htmlFooter_}
+	void addHTTPReply(Reply& r, unsigned status, SharedReply body, std::string_view title, bool keepAlive); // {head, HTML reply}
+	void writeReplies(); // those that are ready, unless a write is in progress
+	bool readError(const boost::system::error_code& error); // true if the session should end
+	void armDeadline(); // for the next request, or the rest of this one
+public:
+	Session* previous_; // in server_->sessions_
+	Session* next_;
+
+	Session(SocketServer* server, Socket_ptr sock, const bool peerAuthenticated) :
+		server_(server),
+		sock_(std::move(sock)),
+		strand_(boost::asio::make_strand(sock_->get_executor())),
+		deadline_(sock_->get_executor()),
+		writing_(false),
+		endSession_(false),
+		authenticationStep_(0),
+		peerAuthenticated_(peerAuthenticated),
+		framingRequested_(false),
+		framed_(false),
+		http_(false),
+		taggedInFlight_(0),
+		readPaused_(false),
+		previous_(nullptr),
+		next_(nullptr)
+		{ server_->addSession(this); }
+	Session(const Session&) = delete;
+	Session& operator=(const Session&) = delete;
+	void pendingOffloads(std::vector<std::shared_ptr<Offloaded>>& pending) {
+		std::lock_guard<std::mutex> lock(offloadedMutex_);
+		for (const auto& w : offloaded_) {
+			if (auto o = w.lock()) pending.push_back(std::move(o));
+		}
+	}
+	~Session() {
+		server_->removeSession(this);
+		if (!sessionAuthorizationFile_.empty()) { // in case of an exception
+			std::remove(sessionAuthorizationFile_.c_str());
+		}
+	}
+
+	void start() { boost::asio::dispatch(strand_, [self = shared_from_this()]() { self->readRequest(); }); }
+	void deliver(const std::shared_ptr<Subscription>& s);
+		// Adds a push of the topic's latest value, if new, unless a write is in progress or the rate limit defers it;
+		// the caller then calls writeReplies()
+	void scheduleDelivery(std::shared_ptr<Subscription> s) {
+		boost::asio::post(strand_, [self = shared_from_this(), s = std::move(s)]() { self->deliver(s); self->writeReplies(); });
+	}
+	void close(); // once the io_services have stopped; its handlers then fail, and release the session
+};
+
+bool SocketServer::Session::hasBufferedLine() const
+{
+	const auto data = buffer_.data();
+	return std::find(boost::asio::buffers_begin(data), boost::asio::buffers_end(data), '\n') != boost::asio::buffers_end(data);
+}
+
+std::size_t SocketServer::Session::nextFrameLength() const
+{
+	if (buffer_.size() < SocketFrame::headerLength) return SocketFrame::headerLength;
+	char header[SocketFrame::headerLength];
+	boost::asio::buffer_copy(boost::asio::buffer(header), buffer_.data());
+	return SocketFrame::headerLength + SocketFrame::fromHeader(header).payloadLength;
+}
+
+bool SocketServer::Session::hasBufferedRequest() const
+{
+	return framed_ ? buffer_.size() >= nextFrameLength() : hasBufferedLine();
+}
+
+void SocketServer::Session::readRequest()
+{
+	if (!server_->listening_) return; // ends the session
+	armDeadline();
+	auto self(shared_from_this());
+	if (framed_) {
+		boost::asio::async_read(*sock_, buffer_, boost::asio::transfer_at_least(nextFrameLength() - buffer_.size()), onStrand([self](const boost::system::error_code& error, std::size_t) { self->handleRequest(error); }));
+	} else if (http_) { // whatever has arrived, as httpParser_ keeps its place
+		boost::asio::async_read(*sock_, buffer_, boost::asio::transfer_at_least(1), onStrand([self](const boost::system::error_code& error, std::size_t) { self->handleRequest(error); }));
+	} else {
+		boost::asio::async_read_until(*sock_, buffer_, '\n', onStrand([self](const boost::system::error_code& error, std::size_t) { self->handleRequest(error); }));
+	}
+}
+
+void SocketServer::Session::armDeadline()
+{
+	std::chrono::steady_clock::duration timeout = server_->idleTimeout_;
+	if (buffer_.size() > 0 || authenticationStep_ < 2) { // part of a request, or not yet authenticated
+		timeout = server_->readTimeout_;
+	} else if (!replies_.empty() || writing_ || !subscriptions_.empty()) { // not idle
+		timeout = std::chrono::steady_clock::duration::zero();
+	}
+	if (timeout == std::chrono::steady_clock::duration::zero()) {
+		deadline_.cancel();
+		return;
+	}
+	deadline_.expires_after(timeout); // cancels the previous wait
+	deadline_.async_wait(onStrand([self = shared_from_this()](const boost::system::error_code& error) {
+		if (error || self->deadline_.expiry() > std::chrono::steady_clock::now()) return; // re-armed
+		try {
+			self->server_->theLogger_->warningToLog("SocketServer closed a session with " + describePeer(*self->sock_) + ", past its deadline");
+		} catch (...) { }
+		boost::system::error_code ignored;
+		self->sock_->close(ignored); // the pending read fails, which ends the session
+	}));
+}
+
+void SocketServer::Session::close()
+{
+	boost::system::error_code ignored;
+	deadline_.cancel();
+	for (auto& s : subscriptions_) {
+		s.second->timer.cancel();
+	}
+	sock_->shutdown(boost::asio::socket_base::shutdown_both, ignored);
+	sock_->close(ignored);
+}
+
+bool SocketServer::Session::readError(const boost::system::error_code& error)
+{
+	if (error == boost::asio::error::eof || error == boost::asio::error::operation_aborted) {
+		return true; // the client disconnected cleanly, or the server is shutting down
+	} else if (error) {
+		try {
+			server_->theLogger_->errorToLog("SocketServer::session(): " + error.message(), "SocketServer::session");
+		} catch (...) { }
+		return true; // terminate the session
+	}
+	return false;
+}
+
+void SocketServer::Session::handleRequest(const boost::system::error_code& error)
+{
+	if (readError(error)) return;
+	arrival_ = std::chrono::steady_clock::now();
+	processBufferedRequests();
+}
+
+void SocketServer::Session::processBufferedRequests()
+{ // Answers every complete request received so far, with a single gathered write of those replies that are ready
+	std::istream is(&buffer_);
+	while (!http_ && !atInFlightLimit() && hasBufferedRequest()) {
+		if (framed_) {
+			processFrame();
+		} else {
+			std::string theString;
+			std::getline(is, theString);
+			if (HTTPParser::startsRequest(theString)) { // the parser takes over, from this line on
+				http_ = true;
+				theString.push_back('\n');
+				httpParser_.parse(theString.data(), theString.length());
+			} else {
+				processRequest(theString);
+			}
+		}
+	}
+	if (http_) {
+		processHTTPRequests();
+	}
+	if (framed_ && nextFrameLength() > SocketFrame::headerLength + SocketFrame::maxPayloadLength) {
+		try {
+			server_->theLogger_->errorToLog("SocketServer::session(): oversized frame; closing the connection", "SocketServer::session");
+		} catch (...) { }
+		endSession_ = true; // as we cannot find the next frame
+	} else if (!endSession_) {
+		if (overLimits()) {
+			readPaused_ = true; // until enough replies are written; once the socket buffers fill, the client's writes block
+		} else {
+			readRequest(); // while the replies are written, and offloaded handlers run
+		}
+	}
+	writeReplies();
+}
+
+std::size_t SocketServer::Session::queuedBytes() const
+{
+	std::size_t bytes = boost::asio::buffer_size(outgoing_);
+	for (const auto& r : replies_) {
+		bytes += boost::asio::buffer_size(r.pieces);
+	}
+	for (const auto& r : taggedReplies_) {
+		bytes += boost::asio::buffer_size(r.pieces);
+	}
+	return bytes;
+}
+
+void SocketServer::Session::resumeReading()
+{
+	if (readPaused_ && !overLimits()) {
+		readPaused_ = false;
+		processBufferedRequests(); // those that waited, then reads again
+	}
+}
+
+void SocketServer::Session::processFrame()
+{
+	char headerBytes[SocketFrame::headerLength];
+	boost::asio::buffer_copy(boost::asio::buffer(headerBytes), buffer_.data());
+	buffer_.consume(SocketFrame::headerLength);
+	const SocketFrame request(SocketFrame::fromHeader(headerBytes));
+	std::string payload(request.payloadLength, '\0');
+	boost::asio::buffer_copy(boost::asio::buffer(payload), buffer_.data());
+	buffer_.consume(payload.length());
+	if (request.flags & SocketFrame::_defineCommand_) {
+		if (request.commandID >= commandNames_.size()) commandNames_.resize(request.commandID + 1);
+		commandNames_[request.commandID] = std::move(payload);
+		return; // no reply
+	}
+	const bool tagged = (request.flags & SocketFrame::_tagged_);
+	std::uint32_t requestID = 0;
+	std::string_view argument(payload);
+	SharedReply result;
+	std::string errMsg;
+	try {
+		if (tagged) {
+			if (payload.length() < sizeof(requestID)) {
+				throw std::runtime_error("tagged frame without a request ID");
+			}
+			std::memcpy(&requestID, payload.data(), sizeof(requestID));
+			requestID = ntohl(requestID);
+			argument.remove_prefix(sizeof(requestID));
+		}
+		if (request.commandID >= commandNames_.size() || commandNames_[request.commandID].empty()) {
+			throw std::runtime_error("command ID " + std::to_string(request.commandID) + " used before being defined");
+		}
+		const std::string& command = commandNames_[request.commandID];
+		if (isOffloaded(command)) {
+			Reply* slot = nullptr; // a tagged reply may overtake the replies to earlier requests
+			if (!tagged) {
+				replies_.emplace_back();
+				slot = &replies_.back();
+			}
+			offload(*OffloadedHandlers::Instance().find(command), command, argument, slot, [commandID = request.commandID, tagged, requestID](Session&, Reply& r, SharedReply payload, bool isError) {
+				if (payload->length() > SocketFrame::maxPayloadLength - sizeof(requestID)) {
+					payload = std::make_shared<const std::string>("SocketServer::session(): the reply to command ID " + std::to_string(commandID) + " is too long for a frame");
+					isError = true;
+				}
+				const std::uint16_t flags = (tagged ? SocketFrame::_tagged_ : 0) | (isError ? SocketFrame::_error_ : 0);
+				addFrameReply(r, commandID, flags, requestID, std::move(payload));
+			});
+			return;
+		}
+		result = runCommand(command, argument, request.commandID);
+		if (result->length() > SocketFrame::maxPayloadLength - sizeof(requestID)) {
+			throw std::runtime_error("the reply to " + command + " is too long for a frame");
+		}
+	} catch (std::exception& e) {
+		errMsg = std::string("SocketServer::session(): ") + e.what();
+	} catch (...) {
+		errMsg = "SocketServer::session(): unknown error, with command ID " + std::to_string(request.commandID);
+	}
+	std::uint16_t flags = tagged ? SocketFrame::_tagged_ : 0;
+	if (!errMsg.empty()) {
+		try {
+			server_->theLogger_->errorToLog(errMsg, "SocketServer::session");
+		} catch (...) { }
+		flags |= SocketFrame::_error_;
+		result = std::make_shared<const std::string>(std::move(errMsg));
+	}
+	replies_.emplace_back();
+	addFrameReply(replies_.back(), request.commandID, flags, requestID, std::move(result));
+}
+
+void SocketServer::Session::processRequest(const std::string& theString)
+{
+	std::string command;
+	std::string errMsg;
+	try {
+		const std::string::size_type p = theString.find(server_->commandFieldSeparator_); // e.g. __+__
+		// Two scenarios: a POST from a web form, or a structured command__+__argument string
+		if (p != std::string::npos) {
+			command = theString.substr(0, p);
+			if (authenticationStep_ >= 2 && command != "AuthStep1" && command != "AuthPeer") {
+				if (isOffloaded(command)) {
+					replies_.emplace_back();
+					offload(*OffloadedHandlers::Instance().find(command), command, std::string_view(theString).substr(p + server_->commandFieldSeparator_.length()), &replies_.back(),
+						[command](Session& session, Reply& r, SharedReply payload, bool isError) mutable {
+							session.addTextReply(r, std::move(command), isError ? std::make_shared<const std::string>("Error: " + *payload) : std::move(payload));
+						});
+					return;
+				}
+			}
+			SharedReply payload(replyToCommand(command, theString, p));
+			replies_.emplace_back();
+			addTextReply(replies_.back(), std::move(command), std::move(payload));
+			return;
+		} else {
+			throw std::runtime_error("Neither the field separator \"" + server_->commandFieldSeparator_ + "\", nor an HTTP request line, were found within: \"" + theString + "\"");
+		}
+	} catch (std::exception& e) {
+		errMsg = std::string("SocketServer::session(): ") + e.what();
+	} catch (...) {
+		errMsg = "SocketServer::session(): unknown error, with string \"" + theString + "\"";
+	}
+	try {
+		server_->theLogger_->errorToLog(errMsg, "SocketServer::session"); // rate-limited if the application calls Logger::setRateLimit() for this key
+	} catch (...) { }
+	if (!command.empty()) {
+		replies_.emplace_back();
+		addTextReply(replies_.back(), std::move(command), std::make_shared<const std::string>("Error: " + errMsg));
+	} // else no reply
+}
+
+void SocketServer::Session::offload(const OffloadedHandlers::Function& handler, std::string_view command, std::string_view argument, Reply* slot, ReplyFormatter format)
+{
+	CommandStats::Counters* stats = server_->commandStats_.find(command);
+	if (stats) {
+		stats->calls.fetch_add(1, std::memory_order_relaxed);
+		stats->bytesIn.fetch_add(argument.length(), std::memory_order_relaxed);
+	}
+	ReplyCache& cache = ReplyCache::Instance();
+	const ReplyCache::Policy* policy = cache.policyOf(command);
+	if (policy) {
+		const auto start = std::chrono::steady_clock::now();
+		if (SharedReply cached = cache.find(command, argument)) {
+			if (stats) {
+				stats->queueTime.record(start - arrival_);
+				stats->handlerTime.record(std::chrono::steady_clock::now() - start);
+				stats->cacheHits.fetch_add(1, std::memory_order_relaxed);
+				stats->bytesOut.fetch_add(cached->length(), std::memory_order_relaxed);
+			}
+			fill(slot, format, std::move(cached), false);
+			return;
+		}
+	}
+	if (slot) {
+		slot->ready = false;
+	} else {
+		++taggedInFlight_;
+	}
+	auto progress = std::make_shared<Offloaded>();
+	progress->session = shared_from_this();
+	progress->arrival = progress->started = arrival_;
+	{
+		std::lock_guard<std::mutex> lock(offloadedMutex_);
+		offloaded_.erase(std::remove_if(offloaded_.begin(), offloaded_.end(), [](const std::weak_ptr<Offloaded>& w) { return w.expired(); }), offloaded_.end());
+		offloaded_.push_back(progress);
+	}
+	Completion done = [slot, format = std::move(format), progress, stats, policy, epoch = cache.epoch(),
+		cacheKey = policy ? std::make_pair(std::string(command), std::string(argument)) : std::pair<std::string, std::string>()](SharedReply payload, bool isError) {
+		std::lock_guard<std::mutex> lock(progress->mutex); // so that the server cannot be destroyed meanwhile
+		const std::shared_ptr<Session> self(std::move(progress->session));
+		if (!self) return; // only the first call counts, and none once the server is being destroyed
+		if (stats) {
+			stats->handlerTime.record(std::chrono::steady_clock::now() - progress->started);
+			if (isError) {
+				stats->errors.fetch_add(1, std::memory_order_relaxed);
+			} else if (payload) {
+				stats->bytesOut.fetch_add(payload->length(), std::memory_order_relaxed);
+			}
+		}
+		if (policy && !isError && payload) {
+			ReplyCache::Instance().insert(*policy, cacheKey.first, cacheKey.second, payload, epoch);
+		}
+		boost::asio::post(self->strand_, [self, slot, format, payload = std::move(payload), isError]() mutable {
+			self->complete(slot, format, std::move(payload), isError);
+		});
+	};
+	auto job = [&handler, argument = std::string(argument), done, progress, stats]() { // the argument is copied, as buffer_ moves on
+		progress->started = std::chrono::steady_clock::now();
+		if (stats) stats->queueTime.record(progress->started - progress->arrival);
+		std::string errMsg;
+		try {
+			std::string_view a(argument);
+			handler(a, done);
+			return;
+		} catch (std::exception& e) {
+			errMsg = std::string("SocketServer::session(): ") + e.what();
+		} catch (...) {
+			errMsg = "SocketServer::session(): unknown error in an offloaded handler";
+		}
+		done(std::make_shared<const std::string>(std::move(errMsg)), true);
+	};
+	if (!server_->offload(job)) {
+		done(std::make_shared<const std::string>("SocketServer::session(): the server is busy; try again later"), true);
+	}
+}
+
+void SocketServer::Session::complete(Reply* slot, const ReplyFormatter& format, SharedReply payload, const bool isError)
+{
+	if (!payload) payload = std::make_shared<const std::string>();
+	if (isError) {
+		try {
+			server_->theLogger_->errorToLog(*payload, "SocketServer::session");
+		} catch (...) { }
+	}
+	if (!slot) --taggedInFlight_;
+	fill(slot, format, std::move(payload), isError);
+	writeReplies();
+}
+
+void SocketServer::Session::fill(Reply* slot, const ReplyFormatter& format, SharedReply payload, const bool isError)
+{
+	if (slot) {
+		format(*this, *slot, std::move(payload), isError);
+		slot->ready = true;
+	} else {
+		taggedReplies_.emplace_back();
+		format(*this, taggedReplies_.back(), std::move(payload), isError);
+	}
+}
+
+void SocketServer::Session::addTextReply(Reply& r, std::string&& command, SharedReply payload)
+{
+	const bool terminated = !payload->empty() && payload->back() == '\n';
+	addSharedPiece(r, std::make_shared<const std::string>(std::move(command)));
+	addLastingPiece(r, server_->outputFieldSeparator_);
+	addSharedPiece(r, std::move(payload));
+	if (!terminated) addLastingPiece(r, newline);
+}
+
+void SocketServer::Session::addFrameReply(Reply& r, const std::uint16_t commandID, const std::uint16_t flags, const std::uint32_t requestID, SharedReply payload)
+{
+	const bool tagged = (flags & SocketFrame::_tagged_);
+	const std::uint32_t length = static_cast<std::uint32_t>(payload->length() + (tagged ? sizeof(requestID) : 0));
+	std::string header(SocketFrame{length, commandID, flags}.header());
+	if (tagged) { // the request ID leads the payload
+		const std::uint32_t id = htonl(requestID);
+		header.append(reinterpret_cast<const char*>(&id), sizeof(id));
+	}
+	addSharedPiece(r, std::make_shared<const std::string>(std::move(header)));
+	addSharedPiece(r, std::move(payload));
+}
+
+void SocketServer::Session::addHTMLReply(Reply& r, SharedReply body, std::string_view title)
+{
+	// The response page: the HTML header, the dynamic page contents or the error message, then the HTML footer
+	if (server_->supportsWebRequests_) {
+		addLastingPiece(r, server_->htmlHeader_);
+		addSharedPiece(r, std::move(body));
+		addLastingPiece(r, server_->htmlFooter_);
+		if (server_->htmlFooter_.empty() || server_->htmlFooter_.back() != '\n') addLastingPiece(r, newline);
+	} else { // Minimal HTML5 header and footer:
+		addSharedPiece(r, std::make_shared<const std::string>("<!DOCTYPE html>\n<html lang=\"en\">\n<meta charset=\"utf-8\">\n<title>" + escapeHTML(title) + "</title>\n<body>\n"));
+		addSharedPiece(r, std::move(body));
+		static const std::string minimalFooter("</body>\n</html>\n");
+		addLastingPiece(r, minimalFooter);
+	}
+}
+
+void SocketServer::Session::addHTTPReply(Reply& r, const unsigned status, SharedReply body, std::string_view title, const bool keepAlive)
+{
+	Reply page;
+	addHTMLReply(page, std::move(body), title);
+	addSharedPiece(r, std::make_shared<const std::string>(httpResponseHead(status, boost::asio::buffer_size(page.pieces), keepAlive)));
+	r.pieces.insert(r.pieces.end(), page.pieces.begin(), page.pieces.end());
+	std::move(page.keepAlive.begin(), page.keepAlive.end(), std::back_inserter(r.keepAlive));
+}
+
+SocketServer::SharedReply SocketServer::Session::replyToCommand(const std::string& command, const std::string& theString, const std::string::size_type p)
+{
+	if (command == "AuthStep1" || command == "AuthPeer") { // The client is attempting to reconnect
+		authenticationStep_ = 0;
+		framingRequested_ = (theString.compare(p + server_->commandFieldSeparator_.length(), std::string::npos, SocketFrame::negotiationString) == 0);
+		if (command == "AuthPeer") { // Instead of AuthStep1 and AuthStep2, over a Unix domain socket
+			if (!peerAuthenticated_) {
+				throw std::runtime_error("Client at " + describePeer(*sock_) + " cannot authenticate by its credentials");
+			}
+			authenticationStep_ = 2;
+			framed_ = framingRequested_; // from the next request on; the client waits for this reply
+			return std::make_shared<const std::string>(framed_ ? SocketFrame::negotiationString : "ok");
+		}
+	}
+	switch (++authenticationStep_) {
+		case 1: {
+			if (command != "AuthStep1") {
+				throw std::runtime_error("Client at " + describePeer(*sock_) + " did not authenticate");
+			}
+			sessionAuthorizationFile_ = "tmp/auth_" + RandNum::generateRandomAlphanumericString(10, 16); // arbitrary file name length
+			sessionAuthorizationStr_ = RandNum::generateRandomAlphanumericString(64, 128); // arbitrary length
+			std::ofstream authFile(sessionAuthorizationFile_);
+			authFile << sessionAuthorizationStr_ << std::endl;
+			authFile.close();
+			if (chmod(sessionAuthorizationFile_.c_str(), ngi::rw)) {
+				throw std::runtime_error("Cannot set user-specific access for AuthStep1 authentication file");
+			} // To be able to read this file, the SocketClient must be this same user.
+			// The client needs the path to the file:
+			auto result = pipe_to_string("pwd");
+			if (result.second) {
+				throw std::runtime_error("Cannot determine the current working directory");
+			}
+			if (result.first.back() == '\n') result.first.pop_back();
+			return std::make_shared<const std::string>(result.first + '/' + sessionAuthorizationFile_);
+		}
+		case 2:
+			if (theString != "AuthStep2" + server_->commandFieldSeparator_ + sessionAuthorizationStr_) {
+				throw std::runtime_error("Client at " + describePeer(*sock_) + " did not send the secret string");
+			}
+			std::remove(sessionAuthorizationFile_.c_str());
+			sessionAuthorizationFile_.clear();
+			framed_ = framingRequested_; // from the next request on; the client waits for this reply
+			return std::make_shared<const std::string>(framed_ ? SocketFrame::negotiationString : "ok");
+		default:
+			// The client has authenticated, so proceed with commands:
+			return runCommand(command, std::string_view(theString).substr(p + server_->commandFieldSeparator_.length())); // argument substring
+	}
+}
+
+SocketServer::SharedReply SocketServer::Session::runCommand(std::string_view command, std::string_view argument, const std::uint16_t commandID)
+{
+	if (command == statsCommand) { // e.g. Stats__+__ for all the commands called so far, or Stats__+__Affect
+		return std::make_shared<const std::string>(server_->commandStats_.textReport(argument));
+	}
+	if (command == subscribeCommand) {
+		return subscribe(argument, commandID);
+	}
+	CommandStats::Counters* stats = server_->commandStats_.find(command);
+	if (!stats) return callHandler(command, argument); // throws, as it is not registered
+	const auto start = std::chrono::steady_clock::now();
+	stats->queueTime.record(start - arrival_);
+	stats->calls.fetch_add(1, std::memory_order_relaxed);
+	stats->bytesIn.fetch_add(argument.length(), std::memory_order_relaxed);
+	bool fromCache = false;
+	try {
+		SharedReply reply(dispatchCommand(command, argument, fromCache));
+		stats->handlerTime.record(std::chrono::steady_clock::now() - start);
+		if (fromCache) stats->cacheHits.fetch_add(1, std::memory_order_relaxed);
+		stats->bytesOut.fetch_add(reply->length(), std::memory_order_relaxed);
+		return reply;
+	} catch (...) {
+		stats->handlerTime.record(std::chrono::steady_clock::now() - start);
+		stats->errors.fetch_add(1, std::memory_order_relaxed);
+		throw;
+	}
 }
 
-std::string decodeURLString(const std::string& URLstr)
+void SocketServer::Session::processHTTPRequests()
 {
-	const std::string::size_type len = URLstr.length();
-	std::string result;
-	for (std::string::size_type i = 0; i < len; ++i) {
-		if (URLstr[i] == '+') {
-			result += ' ';
-		} else if (URLstr[i] == '%') {
-			result += translateHex(URLstr[i + 1]) * 16 + translateHex(URLstr[i + 2]);
-			i += 2; // Move past hex code
-		} else { // An ordinary character
-			result += URLstr[i];
+	while (!endSession_ && !atInFlightLimit()) {
+		const auto data = buffer_.data(); // contiguous
+		buffer_.consume(httpParser_.parse(static_cast<const char*>(data.data()), data.size()));
+		if (httpParser_.failed()) {
+			const std::string errMsg("SocketServer::session(): HTTP request from " + describePeer(*sock_) + ": " + httpParser_.errorMessage());
+			try {
+				server_->theLogger_->errorToLog(errMsg, "SocketServer::session");
+			} catch (...) { }
+			replies_.emplace_back();
+			addHTTPReply(replies_.back(), httpParser_.errorStatus(), std::make_shared<const std::string>(escapeHTML(errMsg)), "ERROR", false);
+			endSession_ = true; // as we cannot find the next request
+			return;
 		}
+		if (!httpParser_.done()) return; // the rest of the request is still to come
+		answerHTTPRequest(httpParser_.request());
+		httpParser_.reset();
 	}
-	return result;
 }
 
-typedef std::map<std::string, std::string> CGImap;
+void SocketServer::Session::answerHTTPRequest(const HTTPParser::Request& request)
+{ // A GET with a query string, or a POST from a web form; either way, the key webCommandString_ names the command
+	unsigned status = 200;
+	std::string errMsg;
+	if (!request.keepAlive) {
+		endSession_ = true; // once this reply is written
+	}
+	replies_.emplace_back();
+	try {
+		if (!server_->supportsWebRequests_) {
+			status = 403;
+			throw std::runtime_error("SocketServer was not configured to accept web requests!");
+		}
+		webFields_.clear();
+		webFields_.parse(request.query());
+		if (request.method == "POST") { // its form fields override those of the target
+			std::string_view form(request.body);
+			while (!form.empty() && (form.back() == '\n' || form.back() == '\r')) form.remove_suffix(1);
+			webFields_.parse(form);
+		}
+		// Process web requests using the set of key-value pairs
+		const std::optional<std::string_view> webCommand(webFields_.find(server_->webCommandString_));
+		if (!webCommand) {
+			status = 400;
+			throw std::runtime_error("The key \"" + server_->webCommandString_ + "\" was not found within the " + request.method + " request for \"" + request.target + "\"");
+		}
+		const std::string_view command(*webCommand);
+		if (command == statsCommand) {
+			if (!server_->webStats_) {
+				status = 403;
+				throw std::runtime_error("web command \"" + statsCommand + "\" is not enabled");
+			}
+			addHTTPReply(replies_.back(), status, std::make_shared<const std::string>(server_->commandStats_.htmlReport()), "SocketServer statistics", request.keepAlive);
+			return;
+		}
+		if (!isWebCommand(command)) {
+			status = 404;
+			throw std::runtime_error("unknown web command \"" + std::string(command) + "\"");
+		}
+		status = 500; // should the handler throw
+		SharedReply body(dispatchWebCommand(command, webFields_));
+		addHTTPReply(replies_.back(), 200, std::move(body), command, request.keepAlive);
+		return;
+	} catch (std::exception& e) {
+		errMsg = std::string("SocketServer::session(): ") + e.what();
+	} catch (...) {
+		errMsg = "SocketServer::session(): unknown error, with target \"" + request.target + "\"";
+	}
+	try {
+		server_->theLogger_->errorToLog(errMsg, "SocketServer::session");
+	} catch (...) { }
+	replies_.back() = Reply();
+	addHTTPReply(replies_.back(), status, std::make_shared<const std::string>(escapeHTML(errMsg)), "ERROR", request.keepAlive);
+}
 
-CGImap parseCGImap(const std::string& query)
+void SocketServer::Session::writeReplies()
 {
-	const std::string::size_type queryLen = query.length();
-	CGImap cgiMap;
-	std::string::size_type index = 0;
-	while (index < queryLen) {
-		std::string::size_type equalSignPos = query.find('=', index);
-		if (equalSignPos == std::string::npos) break;
-		const std::string name(decodeURLString(query.substr(index, equalSignPos++ - index)));
-		index = query.find('&', equalSignPos);
-		cgiMap[name] = decodeURLString(query.substr(equalSignPos, index - equalSignPos));
-		if (index != std::string::npos) {
-			++index;
+	if (writing_) return; // the write handler picks up the rest
+	auto take = [this](Reply& r) {
+		outgoing_.insert(outgoing_.end(), r.pieces.begin(), r.pieces.end());
+		std::move(r.keepAlive.begin(), r.keepAlive.end(), std::back_inserter(outgoingKeepAlive_));
+	};
+	for (auto& r : taggedReplies_) {
+		take(r);
+	}
+	taggedReplies_.clear();
+	while (!replies_.empty() && replies_.front().ready) {
+		take(replies_.front());
+		replies_.pop_front();
+	}
+	if (outgoing_.empty()) {
+		if (endSession_ && replies_.empty()) {
+			boost::system::error_code ignored;
+			sock_->shutdown(boost::asio::socket_base::shutdown_both, ignored);
 		}
+		return;
 	}
-	return cgiMap;
+	writing_ = true;
+	auto self(shared_from_this());
+	boost::asio::async_write(*sock_, outgoing_, onStrand([self](const boost::system::error_code& error, std::size_t) {
+		self->writing_ = false;
+		self->outgoing_.clear();
+		self->outgoingKeepAlive_.clear();
+		if (error) { // terminate the session, once any pending read fails too
+			boost::system::error_code ignored;
+			self->sock_->close(ignored);
+			return;
+		}
+		for (auto& s : self->subscriptions_) {
+			if (s.second->awaitingWrite) self->deliver(s.second); // the latest value, whatever was published meanwhile
+		}
+		self->writeReplies();
+		self->resumeReading();
+		if (!self->writing_ && !self->endSession_) self->armDeadline(); // e.g. idle from now on
+	}));
 }
 
-typedef std::shared_ptr<boost::asio::ip::tcp::socket> Socket_ptr;
+SocketServer::SharedReply SocketServer::Session::subscribe(std::string_view argument, const std::uint16_t commandID)
+{
+	const std::string::size_type p = argument.find(server_->inputFieldSeparator_);
+	const std::string_view topicName(argument.substr(0, p));
+	double maxUpdatesPerSecond = 0; // unlimited
+	if (p != std::string_view::npos) {
+		maxUpdatesPerSecond = std::stod(std::string(argument.substr(p + server_->inputFieldSeparator_.length())));
+	}
+	if (topicName.empty() || topicName == subscribeCommand) {
+		throw std::runtime_error("Subscribe: invalid topic name \"" + std::string(topicName) + "\"");
+	}
+	if (!(maxUpdatesPerSecond == 0 || maxUpdatesPerSecond >= minUpdatesPerSecond)) { // also rejects NaN
+		throw std::runtime_error("Subscribe: invalid rate \"" + std::string(argument.substr(p + server_->inputFieldSeparator_.length())) + "\" (0 for unlimited, or at least 0.001 per second)");
+	}
+	auto it = subscriptions_.find(topicName);
+	if (it == subscriptions_.end()) {
+		auto s = std::make_shared<Subscription>(sock_->get_executor());
+		s->session = shared_from_this();
+		s->topic = server_->topic(topicName);
+		s->topicName = topicName;
+		it = subscriptions_.emplace(s->topicName, s).first;
+		std::lock_guard<std::mutex> lock(s->topic->mutex);
+		s->topic->subscriptions.push_back(s);
+	}
+	Subscription& s = *it->second;
+	s.commandID = commandID;
+	s.minInterval = (maxUpdatesPerSecond > 0) ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / maxUpdatesPerSecond)) : std::chrono::steady_clock::duration::zero();
+	s.notify(); // the current value, if any, after this reply
+	return std::make_shared<const std::string>("ok");
+}
+
+void SocketServer::Subscription::notify()
+{
+	if (notified.exchange(true)) return; // conflated with the delivery already posted
+	if (auto s = session.lock()) {
+		s->scheduleDelivery(shared_from_this());
+	}
+}
+
+void SocketServer::Session::deliver(const std::shared_ptr<Subscription>& s)
+{
+	if (!server_->listening_) return; // shutting down
+	s->notified = false; // before reading the value, so that a later publish() posts again
+	s->awaitingWrite = false;
+	SharedReply value;
+	std::uint64_t version;
+	{
+		std::lock_guard<std::mutex> lock(s->topic->mutex);
+		value = s->topic->latest;
+		version = s->topic->version;
+	}
+	if (version == s->pushedVersion) return; // nothing new
+	if (writing_) { // a slow client: push the latest value once the write completes
+		s->awaitingWrite = true;
+		return;
+	}
+	const auto now = std::chrono::steady_clock::now();
+	if (now < s->lastPush + s->minInterval) {
+		if (!s->timerArmed) {
+			s->timerArmed = true;
+			s->timer.expires_at(s->lastPush + s->minInterval);
+			s->timer.async_wait(onStrand([self = shared_from_this(), s](const boost::system::error_code& error) {
+				s->timerArmed = false;
+				if (error) return;
+				self->deliver(s);
+				self->writeReplies();
+			}));
+		}
+		return;
+	}
+	s->pushedVersion = version;
+	s->lastPush = now;
+	addPush(*s, std::move(value));
+}
 
-void sendString(const Socket_ptr& sock, const std::string& s)
+void SocketServer::Session::addPush(Subscription& s, SharedReply value)
 {
-	const std::string& ns = (s.back() == '\n' ? s : s + '\n'); // Ensure it ends in '\n'
-	boost::asio::write(*sock, boost::asio::buffer(ns.c_str(), ns.length()));
+	if (!framed_ && (value->find('\n') != std::string::npos || value->find("Error:") != std::string::npos)) {
+		// The line would end early, or SocketClient would take it for an error; only framed subscribers get this one
+		server_->theLogger_->warningToLog("SocketServer did not push a value of " + s.topicName + " to a text-mode subscriber, as it contains a newline or \"Error:\"", "SocketServer::push");
+		return;
+	}
+	taggedReplies_.emplace_back();
+	Reply& r = taggedReplies_.back();
+	if (framed_) { // {header, topic name and '\0', value}
+		auto topicName = std::make_shared<const std::string>(s.topicName + '\0');
+		addSharedPiece(r, std::make_shared<const std::string>(SocketFrame{static_cast<std::uint32_t>(topicName->length() + value->length()), s.commandID, SocketFrame::_push_}.header()));
+		addSharedPiece(r, std::move(topicName));
+		addSharedPiece(r, std::move(value));
+	} else {
+		addTextReply(r, std::string(s.topicName), std::move(value));
+	}
 }
 
 
 std::set<short> SocketServer::usedPorts = std::set<short>();
 
+std::shared_ptr<SocketServer::Topic> SocketServer::topic(std::string_view name)
+{
+	std::lock_guard<std::mutex> lock(topicsMutex_);
+	auto it = topics_.find(name);
+	if (it == topics_.end()) {
+		it = topics_.emplace(std::string(name), std::make_shared<Topic>()).first;
+	}
+	return it->second;
+}
+
+void SocketServer::publish(std::string_view topicName, SharedReply value)
+{
+	std::shared_ptr<Topic> t(topic(topicName));
+	std::lock_guard<std::mutex> lock(t->mutex);
+	t->latest = std::move(value);
+	++t->version;
+	auto& subscriptions = t->subscriptions;
+	subscriptions.erase(std::remove_if(subscriptions.begin(), subscriptions.end(), [](const std::weak_ptr<Subscription>& w) {
+		if (auto s = w.lock()) {
+			s->notify(); // posts at most one delivery, however often the topic is published
+			return false;
+		}
+		return true; // its session has ended
+	}), subscriptions.end());
+}
+
+struct SocketServer::AcceptorShard {
+	boost::asio::io_service io_service;
+	Strand strand; // for the acceptor
+	std::unique_ptr<Acceptor> acceptor;
+	std::thread thread; // runs io_service
+
+	AcceptorShard() : strand(boost::asio::make_strand(io_service)) { }
+};
+
+namespace {
+
+std::unique_ptr<boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol>> openSharedPort(boost::asio::io_service& io_service, const short port)
+{ // One of several acceptors on port, between which the kernel balances the incoming connections
+	typedef boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> Acceptor;
+	const Acceptor::endpoint_type endpoint(boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port));
+	auto acceptor = std::make_unique<Acceptor>(io_service);
+	acceptor->open(endpoint.protocol());
+	acceptor->set_option(boost::asio::socket_base::reuse_address(true));
+	const int on = 1;
+	if (setsockopt(acceptor->native_handle(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+		throw std::runtime_error("SO_REUSEPORT: " + std::string(std::strerror(errno)));
+	}
+	acceptor->bind(endpoint);
+	acceptor->listen();
+	return acceptor;
+}
+
+bool isSocketFile(const std::string& path)
+{ // false for a missing path, and for anything else at it, such as a regular file
+	struct stat status;
+	return lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode);
+}
+
+std::unique_ptr<boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol>> openUnixSocket(boost::asio::io_service& io_service, const std::string& path)
+{ // Accessible to this user only, before it accepts any connection
+	typedef boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> Acceptor;
+	if (isSocketFile(path)) {
+		unlink(path.c_str()); // left behind by an earlier run
+	} else if (access(path.c_str(), F_OK) == 0) {
+		throw std::runtime_error(path + " exists, and is not a socket");
+	}
+	const Acceptor::endpoint_type endpoint{boost::asio::local::stream_protocol::endpoint(path)};
+	auto acceptor = std::make_unique<Acceptor>(io_service);
+	acceptor->open(endpoint.protocol());
+	boost::system::error_code error;
+	acceptor->bind(endpoint, error);
+	if (error) {
+		throw boost::system::system_error(error, "bind " + path);
+	}
+	if (chmod(path.c_str(), S_IRUSR | S_IWUSR) != 0) { // connecting fails until listen(), so nobody gets in before this
+		const int theError = errno;
+		unlink(path.c_str());
+		throw std::runtime_error("cannot chmod " + path + " (" + std::strerror(theError) + ')');
+	}
+	acceptor->listen();
+	return acceptor;
+}
+
+} // namespace
+
 SocketServer::SocketServer(Logger* theLogger, short port, const std::string& htmlHeaderFooterFileName, const bool isHTTPS, const std::string& cmdArgSeparatorTag, const std::string& outResultSeparatorTag, const std::string& inputFieldSeparatorTag, const std::string& webCommandStr) :
+	sessions_(nullptr),
+	numSessions_(0),
+	acceptorStrand_(boost::asio::make_strand(io_service_)),
+	numAcceptorShards_(1),
+	launched_(false),
+	idleTimeout_(std::chrono::steady_clock::duration::zero()),
+	readTimeout_(std::chrono::seconds(30)),
+	maxSessions_(4096),
+	maxInFlightPerSession_(1024),
+	maxQueuedBytesPerSession_(16 << 20),
 	theLogger_(theLogger),
 	commandFieldSeparator_(cmdArgSeparatorTag),
 	outputFieldSeparator_(outResultSeparatorTag),
@@ -104,11 +1141,18 @@ SocketServer::SocketServer(Logger* theLogger, short port, const std::string& htm
 	portString_(std::to_string(port)),
 	port_(port),
 	listening_(true),
-	supportsWebRequests_(!htmlHeaderFooterFileName.empty() && htmlHeaderFooterFileName.find("N/A") != 0)
+	supportsWebRequests_(!htmlHeaderFooterFileName.empty() && htmlHeaderFooterFileName.find("N/A") != 0),
+	webStats_(false),
+	numWorkers_(0),
+	maxQueuedWork_(1024),
+	stopWorkers_(false)
 {
 	if (!usedPorts.insert(port).second) {
 		throw std::runtime_error("SocketServer::SocketServer(): a server listening on port " + portString_ + " was already instantiated.");
 	}
+	theLogger_->setRateLimit("SocketServer::accept", 1.0, 5.0); // accept errors, which tend to persist
+	theLogger_->setRateLimit("SocketServer::push", 1.0, 5.0); // values that text-mode subscribers cannot receive, perhaps once per cycle
+	theLogger_->setRateLimit("SocketServer::admission", 1.0, 5.0); // connections rejected at the session limit, which come in storms
 	theLogger_->addToLog("SocketServer instantiated with port " + portString_);
 	
 	if (supportsWebRequests_) {
@@ -138,13 +1182,30 @@ SocketServer::~SocketServer()
 {
 	try { // Try to shut the server down cleanly
 		stopAcceptingConnections();
-		// Close any active sessions that were spawned off:
-		for (auto& it : mySockets_) {
-			Socket_ptr s(it.lock());
-			if (s) {
-				s->shutdown(boost::asio::ip::tcp::socket::shutdown_both);
-				s->close();
-			}
+		// Stop the pool and the shards, then close any active sessions:
+		io_service_.stop();
+		for (auto& shard : shards_) {
+			shard->io_service.stop();
+		}
+		for (auto& t : threads_) {
+			if (t.joinable()) t.join();
+		}
+		for (auto& shard : shards_) {
+			if (shard->thread.joinable()) shard->thread.join();
+		}
+		stopWorkerPool(); // waits for the running handlers; their completions then fail with their sessions
+		abandonOffloadedHandlers(); // whose Completions the application may still hold
+		closeAcceptor();
+		for (auto& shard : shards_) {
+			boost::system::error_code ignored;
+			shard->acceptor->close(ignored);
+		}
+		closeSessions();
+		io_service_.restart();
+		io_service_.run(); // the pending handlers fail at once, releasing their sessions
+		for (auto& shard : shards_) {
+			shard->io_service.restart();
+			shard->io_service.run();
 		}
 		usedPorts.erase(port_);
 	} catch (std::exception& e) {
@@ -160,231 +1221,335 @@ SocketServer::~SocketServer()
 
 void SocketServer::stopAcceptingConnections()
 {
-	if (listening_) { // if the server() function is still running
+	if (listening_.exchange(false)) { // if the acceptors are still waiting for connections
+		boost::asio::post(acceptorStrand_, [this]() { closeAcceptor(); }); // cancels the pending accepts
+		for (auto& shard : shards_) {
+			boost::asio::post(shard->strand, [s = shard.get()]() {
+				boost::system::error_code ignored;
+				s->acceptor->close(ignored);
+			});
+		}
+	}
+}
+
+void SocketServer::launchServer(SocketServer::Sync isBlocking, unsigned numThreads)
+{
+	launched_ = true;
+	if (numThreads == 0) {
+		numThreads = std::max(1U, std::thread::hardware_concurrency());
+	}
+	// Registration must be complete, as the pool's threads look handlers up without locking:
+	FunctionRegistry<SharedReply, std::string_view>::Instance().freeze();
+	FunctionRegistry<std::string, std::string_view>::Instance().freeze();
+	FunctionRegistry<std::string, const std::string&>::Instance().freeze();
+	FunctionRegistry<SharedReply, const CGIViewMap&>::Instance().freeze();
+	FunctionRegistry<std::string, const CGIViewMap&>::Instance().freeze();
+	FunctionRegistry<SharedReply, const CGImap&>::Instance().freeze();
+	FunctionRegistry<std::string, const CGImap&>::Instance().freeze();
+	OffloadedHandlers::Instance().freeze();
+	ReplyCache::Instance().freeze();
+	auto addStats = [this](std::string_view command) { commandStats_.add(command); };
+	FunctionRegistry<SharedReply, std::string_view>::Instance().forEachKey(addStats);
+	FunctionRegistry<std::string, std::string_view>::Instance().forEachKey(addStats);
+	FunctionRegistry<std::string, const std::string&>::Instance().forEachKey(addStats);
+	OffloadedHandlers::Instance().forEachKey(addStats);
+	try {
+		for (const std::string& reserved : { statsCommand, subscribeCommand }) { // would be shadowed, so never called
+			if (FunctionRegistry<SharedReply, std::string_view>::Instance().isRegistered(reserved) || FunctionRegistry<std::string, std::string_view>::Instance().isRegistered(reserved)
+					|| FunctionRegistry<std::string, const std::string&>::Instance().isRegistered(reserved) || OffloadedHandlers::Instance().isRegistered(reserved)
+					|| (reserved == statsCommand && isWebCommand(reserved))) {
+				throw std::runtime_error("a handler is registered as " + reserved + ", which is a reserved command");
+			}
+		}
+		if (numAcceptorShards_ > 1) {
+			for (unsigned i = 0; i < numAcceptorShards_; ++i) {
+				shards_.push_back(std::make_unique<AcceptorShard>());
+				shards_.back()->acceptor = openSharedPort(shards_.back()->io_service, port_);
+			}
+		} else {
+			acceptor_ = std::make_unique<Acceptor>(io_service_, Acceptor::endpoint_type(boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port_)));
+		}
+		if (!unixSocketPath_.empty()) {
+			unixAcceptor_ = openUnixSocket(io_service_, unixSocketPath_); // in addition to the credentials check
+		}
+	} catch (std::exception& e) {
 		listening_ = false;
-		// Wake up the server so that it notices that listening_ is now false:
+		shards_.clear();
 		try {
-			using boost::asio::ip::tcp;
-			tcp::resolver resolver_(io_service_);
-			tcp::resolver::query q(tcp::v4(), boost::asio::ip::host_name(), portString_);
-			tcp::resolver::iterator i(resolver_.resolve(q));
-			tcp::socket socket(io_service_);
-			boost::asio::connect(socket, i);
-		} catch (std::exception& e) {
+			theLogger_->errorToLog(std::string("SocketServer::launchServer(): ") + e.what());
+		} catch (...) { }
+		return;
+	}
+	if (shards_.empty()) {
+		theLogger_->addToLog("SocketServer is listening on port " + portString_ + (unixAcceptor_ ? " and socket " + unixSocketPath_ : std::string()) + " with " + std::to_string(numThreads) + (numThreads == 1 ? " thread" : " threads"));
+		acceptConnection(*acceptor_, acceptorStrand_, "port " + portString_);
+	} else {
+		theLogger_->addToLog("SocketServer is listening on port " + portString_ + " with " + std::to_string(shards_.size()) + " acceptor shards" + (unixAcceptor_ ? ", and on socket " + unixSocketPath_ + " with " + std::to_string(numThreads) + (numThreads == 1 ? " thread" : " threads") : std::string()));
+		for (auto& shard : shards_) {
+			acceptConnection(*shard->acceptor, shard->strand, "port " + portString_);
+			shard->thread = std::thread([this, s = shard.get()]() { runIOService(s->io_service); });
+		}
+	}
+	if (unixAcceptor_) {
+		acceptConnection(*unixAcceptor_, acceptorStrand_, "socket " + unixSocketPath_);
+	}
+	if (OffloadedHandlers::Instance().size() > 0) {
+		const unsigned numWorkers = (numWorkers_ > 0) ? numWorkers_ : std::max(1U, std::thread::hardware_concurrency());
+		for (unsigned i = 0; i < numWorkers; ++i) {
+			workers_.emplace_back(&SocketServer::runWorker, this);
+		}
+		theLogger_->addToLog("SocketServer runs offloaded handlers with " + std::to_string(numWorkers) + (numWorkers == 1 ? " worker" : " workers"));
+	}
+	if (!shards_.empty() && !unixAcceptor_) { // io_service_ has nothing to serve
+		if (isBlocking == Sync::blocking) {
+			for (auto& shard : shards_) {
+				shard->thread.join(); // run forever
+			}
+		}
+		return;
+	}
+	const unsigned numBackgroundThreads = (isBlocking == Sync::blocking) ? numThreads - 1 : numThreads;
+	for (unsigned i = 0; i < numBackgroundThreads; ++i) {
+		threads_.emplace_back([this]() { runIOService(io_service_); });
+	}
+	if (isBlocking == Sync::blocking) { // single-purpose server application
+		runIOService(io_service_); // run forever
+		for (auto& t : threads_) {
+			t.join();
+		}
+		threads_.clear();
+	} // else application that includes a server: the pool runs for the lifetime of SocketServer
+}
+
+void SocketServer::runIOService(boost::asio::io_service& ioService)
+{
+	for (;;) {
+		try {
+			ioService.run();
+			return; // stopped, or out of work
+		} catch (std::exception& e) { // thrown by a handler; keep serving the other sessions
 			try {
-				theLogger_->warningToLog(std::string("SocketServer::stopAcceptingConnections(): ") + e.what());
+				theLogger_->errorToLog(std::string("SocketServer::runIOService(): ") + e.what());
 			} catch (...) { }
 		} catch (...) {
 			try {
-				theLogger_->warningToLog("SocketServer::stopAcceptingConnections(): unknown error");
+				theLogger_->errorToLog("SocketServer::runIOService(): unknown error");
 			} catch (...) { }
 		}
-		// Wait for the server() function to complete:
-		std::lock_guard<std::mutex> lock(myServerActiveMutex_);
 	}
 }
 
-void SocketServer::launchServer(SocketServer::Sync isBlocking)
+void SocketServer::setSessionTimeouts(const std::chrono::steady_clock::duration idleTimeout, const std::chrono::steady_clock::duration readTimeout)
 {
-	std::thread t(&SocketServer::server, this);
-	if (isBlocking == Sync::blocking) { // single-purpose server application
-		t.join(); // run forever
-	} else { // application that includes a server
-		t.detach(); // run for the lifetime of SocketServer
+	if (launched_) {
+		throw std::runtime_error("SocketServer::setSessionTimeouts(), must be called before launchServer()");
 	}
+	idleTimeout_ = idleTimeout;
+	readTimeout_ = readTimeout;
 }
 
-void SocketServer::cleanUpExpiredSockets()
+void SocketServer::setAdmissionLimits(const std::size_t maxSessions, const std::size_t maxInFlightRequests, const std::size_t maxQueuedBytes)
 {
-	std::list<std::weak_ptr<boost::asio::ip::tcp::socket>>::iterator it = mySockets_.begin();
-	while (it != mySockets_.end()) {
-		if (it->expired()) {
-			it = mySockets_.erase(it);
-		} else {
-			++it;
-		}
+	if (launched_) {
+		throw std::runtime_error("SocketServer::setAdmissionLimits(), must be called before launchServer()");
 	}
+	maxSessions_ = maxSessions;
+	maxInFlightPerSession_ = maxInFlightRequests;
+	maxQueuedBytesPerSession_ = maxQueuedBytes;
 }
 
-std::string SocketServer::insertOutputFieldSeparator(std::string prefix, const std::string& s)
+void SocketServer::setWebStats(const bool enable)
 {
-	return prefix + outputFieldSeparator_ + s;
+	if (launched_) {
+		throw std::runtime_error("SocketServer::setWebStats(), must be called before launchServer()");
+	}
+	webStats_ = enable;
 }
 
-void SocketServer::server()
+void SocketServer::setAcceptorShards(const unsigned numShards)
 {
-	try {
-		boost::asio::ip::tcp::acceptor a(io_service_, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port_));
-		theLogger_->addToLog("SocketServer is listening on port " + portString_);
-		std::lock_guard<std::mutex> lock(myServerActiveMutex_);
-		for (;;) {
-			cleanUpExpiredSockets();
-			Socket_ptr sock(std::make_shared<boost::asio::ip::tcp::socket>(io_service_));
-			mySockets_.push_back(sock); // list<weak_ptr<socket>>
-			a.accept(*sock); // blocks until a client connects to the port
-			if (!listening_) break;
-			theLogger_->addToLog("SocketServer accepted a connection from " + sock->remote_endpoint().address().to_string() + " on port " + portString_);
-			// Spawn a session on a new thread and resume listening:
-			std::thread t(&SocketServer::session, this, sock);
-			t.detach();
+	if (launched_) {
+		throw std::runtime_error("SocketServer::setAcceptorShards(), must be called before launchServer()");
+	}
+	numAcceptorShards_ = (numShards > 0) ? numShards : std::max(1U, std::thread::hardware_concurrency());
+}
+
+void SocketServer::setWorkerPool(const unsigned numWorkers, const std::size_t maxQueuedHandlers)
+{
+	if (launched_) {
+		throw std::runtime_error("SocketServer::setWorkerPool(), must be called before launchServer()");
+	}
+	numWorkers_ = numWorkers;
+	maxQueuedWork_ = std::max<std::size_t>(1, maxQueuedHandlers);
+}
+
+bool SocketServer::offload(const std::function<void()>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(workMutex_);
+		if (stopWorkers_ || work_.size() >= maxQueuedWork_) return false;
+		work_.push_back(job);
+	}
+	workAvailable_.notify_one();
+	return true;
+}
+
+void SocketServer::runWorker()
+{
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(workMutex_);
+			workAvailable_.wait(lock, [this]() { return stopWorkers_ || !work_.empty(); });
+			if (stopWorkers_) return;
+			job = std::move(work_.front());
+			work_.pop_front();
 		}
-	} catch (std::exception& e) {
-		try {
-			theLogger_->errorToLog(std::string("SocketServer::server(): ") + e.what());
-		} catch (...) { }
-	} catch (...) {
-		try {
-			theLogger_->errorToLog("SocketServer::server(): unknown error");
-		} catch (...) { }
+		job(); // reports its own exceptions through its Completion
 	}
-	listening_ = false; // explicit, in case there were exceptions
-	theLogger_->addToLog("SocketServer is no longer listening on port " + portString_);
 }
 
-void SocketServer::session(Socket_ptr sock)
+void SocketServer::stopWorkerPool()
 {
-	// Note: for non-POST requests, the first requests need to be about authentication, to verify that the client user is the server user.
-	std::string sessionAuthorizationFile, sessionAuthorizationStr;
-	std::uint64_t authenticationStep = 0;
-	while (listening_) {
-		std::string theString, command;
-		bool isPOST = false;
-		try {
-			boost::system::error_code error;
-			boost::asio::streambuf b;
-			boost::asio::read_until(*sock, b, '\n', error);
-			if (error == boost::asio::error::eof) {
-				break; // the client disconnected cleanly
-			} else if (error) {
-				throw boost::system::system_error(error);
-			}
-			std::istream is(&b);
-			std::getline(is, theString);
-			const std::string::size_type p = theString.find(commandFieldSeparator_); // e.g. __+__
-			// Two scenarios: a POST from a web form, or a structured command__+__argument string
-			if (p != std::string::npos) {
-				command = theString.substr(0, p);
-				if (command == "AuthStep1") { // The client is attempting to reconnect
-					authenticationStep = 0;
-				}
-				switch (++authenticationStep) {
-					case 1:
-						if (command != "AuthStep1") {
-							throw std::runtime_error("Client at " + sock->remote_endpoint().address().to_string() + " did not authenticate");
-						} else {
-							sessionAuthorizationFile = "tmp/auth_" + RandNum::generateRandomAlphanumericString(10, 16); // arbitrary file name length
-							sessionAuthorizationStr = RandNum::generateRandomAlphanumericString(64, 128); // arbitrary length
-							std::ofstream authFile(sessionAuthorizationFile);
-							authFile << sessionAuthorizationStr << std::endl;
-							authFile.close();
-							if (chmod(sessionAuthorizationFile.c_str(), ngi::rw)) {
-								throw std::runtime_error("Cannot set user-specific access for AuthStep1 authentication file");
-							} // To be able to read this file, the SocketClient must be this same user.
-							// The client needs the path to the file:
-							auto result = pipe_to_string("pwd");
-							if (result.second) {
-								throw std::runtime_error("Cannot determine the current working directory");
-							}
-							if (result.first.back() == '\n') result.first.pop_back();
-							sendString(sock, insertOutputFieldSeparator(command, result.first + '/' + sessionAuthorizationFile));
-						}
-						break;
-					case 2:
-						if (theString != "AuthStep2" + commandFieldSeparator_ + sessionAuthorizationStr) {
-							throw std::runtime_error("Client at " + sock->remote_endpoint().address().to_string() + " did not send the secret string");
-						} else {
-							std::remove(sessionAuthorizationFile.c_str());
-							sessionAuthorizationFile.clear();
-							sendString(sock, insertOutputFieldSeparator(command, "ok"));
-						}
-						break;
-					default:
-						// The client has authenticated, so proceed with commands:
-						sendString(sock, insertOutputFieldSeparator(command, FunctionRegistry<std::string, const std::string&>::Instance()(command, theString.substr(p + commandFieldSeparator_.length())))); // argument substring
-				}
-			} else if (theString.find("POST /") != std::string::npos) {
-				isPOST = true;
-				if (!supportsWebRequests_) {
-					throw std::runtime_error("SocketServer was not configured to accept web requests!");
-				}
-				boost::asio::read_until(*sock, b, "Submit+This+Form", error);
-				if (error == boost::asio::error::eof) {
-					break; // the client disconnected cleanly
-				} else if (error) {
-					throw boost::system::system_error(error);
-				}
-				// Parse out the argument string:
-				while (is && theString.find("Submit+This+Form") == std::string::npos) {
-					std::getline(is, theString);
-				}
-				if (!is) {
-					throw std::runtime_error("Error parsing POST query string");
-				}
-				const CGImap cgim(parseCGImap(theString));
-				// Process web requests using the set of key-value pairs where value = cgim[key]
-				auto webCommand = cgim.find(webCommandString_);
-				if (webCommand == cgim.cend()) {
-					throw std::runtime_error("The key \"" + webCommandString_ + "\" was not found within the POST string: \"" + theString + "\"");
-				}
-				sendString(sock, applyHTMLFormatting(FunctionRegistry<std::string, const CGImap&>::Instance()(webCommand->second, cgim), webCommand->second));
-				break; // done with the POST request
-			} else {
-				throw std::runtime_error("Neither the field separator \"" + commandFieldSeparator_ + "\", nor \"POST /\", were found within: \"" + theString + "\"");
-			}
-		} catch (std::exception& e) {
+	{
+		std::lock_guard<std::mutex> lock(workMutex_);
+		stopWorkers_ = true;
+		work_.clear();
+	}
+	workAvailable_.notify_all();
+	for (auto& t : workers_) {
+		if (t.joinable()) t.join();
+	}
+	workers_.clear();
+}
+
+void SocketServer::listenOnUnixSocket(const std::string& socketPath)
+{
+	if (launched_) {
+		throw std::runtime_error("SocketServer::listenOnUnixSocket(), must be called before launchServer()");
+	}
+	unixSocketPath_ = socketPath;
+}
+
+void SocketServer::acceptConnection(Acceptor& acceptor, Strand& strand, const std::string& endpointName)
+{ // The session runs on the acceptor's io_service
+	Socket_ptr sock(std::make_shared<Socket>(acceptor.get_executor()));
+	acceptor.async_accept(*sock, boost::asio::bind_executor(strand, [this, sock, &acceptor, &strand, endpointName](const boost::system::error_code& error) {
+		if (!listening_ || error == boost::asio::error::operation_aborted) { // closed by stopAcceptingConnections()
+			return;
+		}
+		if (error) { // e.g. out of file descriptors (EMFILE), which retrying at once would not cure
 			try {
-				const std::string errMsg(std::string("SocketServer::session(): ") + e.what());
-				theLogger_->errorToLog(errMsg);
-				if (isPOST) {
-					sendString(sock, applyHTMLFormatting(errMsg, "ERROR"));
-					break; // done with the POST request
-				} else if (!command.empty()) {
-					sendString(sock, insertOutputFieldSeparator(command, std::string("Error: ") + errMsg));
-				} // else no reply
-			} catch (...) {
-				break; // terminate the session
-			}
-		} catch (...) {
+				theLogger_->errorToLog("SocketServer::acceptConnection(): " + error.message(), "SocketServer::accept");
+			} catch (...) { }
+			auto backoff = std::make_shared<boost::asio::steady_timer>(acceptor.get_executor(), std::chrono::milliseconds(100));
+			backoff->async_wait(boost::asio::bind_executor(strand, [this, backoff, &acceptor, &strand, endpointName](const boost::system::error_code& error) {
+				if (!error && listening_) acceptConnection(acceptor, strand, endpointName);
+			}));
+			return;
+		} else {
+			bool reserved = false;
 			try {
-				const std::string errMsg("SocketServer::session(): unknown error, with string \"" + theString + "\"");
-				theLogger_->errorToLog(errMsg);
-				if (isPOST) {
-					sendString(sock, applyHTMLFormatting(errMsg, "ERROR"));
-					break; // done with the POST request
-				} else if (!command.empty()) {
-					sendString(sock, insertOutputFieldSeparator(command, std::string("Error: ") + errMsg));
-				} // else no reply
-			} catch (...) {
-				break; // terminate the session
+				if (!reserveSession()) {
+					rejectConnection(sock);
+					acceptConnection(acceptor, strand, endpointName);
+					return;
+				}
+				reserved = true;
+				ucred credentials;
+				const bool peerAuthenticated = (&acceptor == unixAcceptor_.get() && peerCredentials(*sock, &credentials) && credentials.uid == geteuid());
+				theLogger_->addToLog("SocketServer accepted a connection from " + describePeer(*sock) + " on " + endpointName);
+				auto session = std::make_shared<Session>(this, sock, peerAuthenticated);
+				reserved = false; // the session holds the slot, until it is destroyed
+				session->start();
+			} catch (std::exception& e) { // e.g. the client has already disconnected
+				if (reserved) releaseSession();
+				try {
+					theLogger_->warningToLog(std::string("SocketServer::acceptConnection(): ") + e.what());
+				} catch (...) { }
 			}
 		}
+		acceptConnection(acceptor, strand, endpointName); // resume listening
+	}));
+}
+
+void SocketServer::closeAcceptor()
+{ // Those on io_service_; the shards close their own
+	boost::system::error_code ignored;
+	if (unixAcceptor_ && unixAcceptor_->is_open()) {
+		unixAcceptor_->close(ignored);
+		if (isSocketFile(unixSocketPath_)) unlink(unixSocketPath_.c_str());
 	}
-	if (!sessionAuthorizationFile.empty()) { // in case of an exception
-		std::remove(sessionAuthorizationFile.c_str());
+	if (acceptor_ && acceptor_->is_open()) {
+		acceptor_->close(ignored);
+		listening_ = false; // explicit, in case there were errors
+		theLogger_->addToLog("SocketServer is no longer listening on port " + portString_);
 	}
 }
 
-std::string SocketServer::applyHTMLFormatting(const std::string& s, const std::string& title)
+void SocketServer::addSession(Session* session)
 {
-	// Create the response page, starting with the HTML header:
-	std::string page;
-	if (supportsWebRequests_) {
-		page = htmlHeader_;
-	} else { // Minimal HTML5 header:
-		page = "<!DOCTYPE html>\n";
-		page += "<html lang=\"en\">\n";
-		page += "<meta charset=\"utf-8\">\n";
-		page += "<title>" + title + "</title>\n";
-		page += "<body>\n";
-	}
-	// Add the dynamic page contents, or the error message:
-	page += s;
-	// Add the HTML footer information:
-	if (supportsWebRequests_) {
-		page += htmlFooter_;
-	} else { // Minimal footer:
-		page += "</body>\n";
-		page += "</html>\n";
+	std::lock_guard<std::mutex> lock(sessionsMutex_);
+	session->next_ = sessions_;
+	if (sessions_) sessions_->previous_ = session;
+	sessions_ = session; // in the slot reserved for it
+}
+
+void SocketServer::removeSession(Session* session)
+{
+	std::lock_guard<std::mutex> lock(sessionsMutex_);
+	(session->previous_ ? session->previous_->next_ : sessions_) = session->next_;
+	if (session->next_) session->next_->previous_ = session->previous_;
+	--numSessions_;
+}
+
+bool SocketServer::reserveSession()
+{ // The check and the increment are one step, as the acceptor shards accept concurrently
+	std::lock_guard<std::mutex> lock(sessionsMutex_);
+	if (maxSessions_ > 0 && numSessions_ >= maxSessions_) return false;
+	++numSessions_;
+	return true;
+}
+
+void SocketServer::releaseSession()
+{
+	std::lock_guard<std::mutex> lock(sessionsMutex_);
+	--numSessions_;
+}
+
+void SocketServer::rejectConnection(std::shared_ptr<Socket> sock)
+{
+	try {
+		theLogger_->warningToLog("SocketServer rejected a connection from " + describePeer(*sock) + ", at its limit of " + std::to_string(maxSessions_) + " sessions", "SocketServer::admission");
+	} catch (...) { }
+	auto message = std::make_shared<const std::string>("Error: SocketServer is at its limit of " + std::to_string(maxSessions_) + " sessions; try again later\n");
+	boost::asio::async_write(*sock, boost::asio::buffer(*message), [sock, message](const boost::system::error_code&, std::size_t) {
+		boost::system::error_code ignored;
+		sock->shutdown(boost::asio::socket_base::shutdown_both, ignored);
+		sock->close(ignored);
+	});
+}
+
+void SocketServer::abandonOffloadedHandlers()
+{ // Releases the sessions held by pending Completions, so that calling or destroying one later touches nothing of ours
+	std::vector<std::shared_ptr<Session::Offloaded>> pending;
+	{
+		std::lock_guard<std::mutex> lock(sessionsMutex_);
+		for (Session* session = sessions_; session; session = session->next_) {
+			session->pendingOffloads(pending);
+		}
+	}
+	for (auto& offloaded : pending) {
+		std::shared_ptr<Session> session; // released after the lock, possibly ending the session
+		std::lock_guard<std::mutex> lock(offloaded->mutex); // waits for a completion in progress
+		session.swap(offloaded->session);
+	}
+}
+
+void SocketServer::closeSessions()
+{ // Requires that no thread is running io_service_, or the shards' io_services
+	std::lock_guard<std::mutex> lock(sessionsMutex_);
+	for (Session* session = sessions_; session; session = session->next_) {
+		session->close();
 	}
-	return page;
 }
@@ -1,8 +1,8 @@
 // classSocketServer.h
-// Version 2021.12.24
+// Version 2026.10.16
 
 /*
-Copyright (c) 2014-2021, NeuroGadgets Inc.
+Copyright (c) 2014-2026, NeuroGadgets Inc.
 Author: Robert L. Charlebois
 All rights reserved.
 
@@ -32,13 +32,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef CLASS_REMOTE_DAEMON_SERVER_H
 #define CLASS_REMOTE_DAEMON_SERVER_H
 
+#include "classCommandStats.h"
 #include "classLogger.h"
 #include <atomic>
-#include <list>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <vector>
 #include <boost/asio.hpp>
 
 class Logger;
@@ -49,9 +56,32 @@ private:
 		// allows multiple servers to coexist within an application, if they listen on different ports
 		// Note: this does not currently verify that those ports are unused system-wide! ###
 
+	class Session; // one per connection, driven by asynchronous reads and writes on io_service_
+	class Topic; // the latest value published under a name, and its subscriptions
+	struct Subscription; // of a session to a topic
+	typedef boost::asio::generic::stream_protocol::socket Socket; // TCP, or AF_UNIX
+	typedef boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> Acceptor;
+	typedef boost::asio::strand<boost::asio::io_service::executor_type> Strand;
+	struct AcceptorShard; // an acceptor on port_, with its own io_service and thread, for the sessions it accepts
+
+	// Declared before the io_services, which are destroyed first, with any handlers that still hold a session:
+	Session* sessions_; // the live sessions, as an intrusive list, so that adding and removing one is O(1)
+	std::size_t numSessions_; // including the slots reserved for sessions being created
+	std::mutex sessionsMutex_;
 	boost::asio::io_service io_service_;
-	std::list<std::weak_ptr<boost::asio::ip::tcp::socket>> mySockets_;
-	std::mutex myServerActiveMutex_;
+	Strand acceptorStrand_; // for the acceptors, which are not thread-safe
+	std::unique_ptr<Acceptor> acceptor_; // unless sharded
+	std::unique_ptr<Acceptor> unixAcceptor_; // if listenOnUnixSocket() was called
+	std::string unixSocketPath_;
+	std::vector<std::thread> threads_; // each runs io_service_; the calling thread also does in blocking mode
+	std::vector<std::unique_ptr<AcceptorShard>> shards_; // if setAcceptorShards() asked for more than one
+	unsigned numAcceptorShards_;
+	bool launched_;
+	std::chrono::steady_clock::duration idleTimeout_; // zero: none
+	std::chrono::steady_clock::duration readTimeout_; // zero: none
+	std::size_t maxSessions_; // zero: no limit, as for the two below
+	std::size_t maxInFlightPerSession_; // requests whose replies are not yet written
+	std::size_t maxQueuedBytesPerSession_; // of replies not yet written
 	Logger* theLogger_; // non-owning pointer
 	std::string htmlHeader_;
 	std::string htmlFooter_;
@@ -65,15 +95,54 @@ private:
 	short port_;
 	std::atomic<bool> listening_;
 	bool supportsWebRequests_;
+	bool webStats_; // whether web requests may ask for Stats, as they are not authenticated
+	CommandStats commandStats_; // of each registered command
+	std::map<std::string, std::shared_ptr<Topic>, std::less<>> topics_;
+	std::mutex topicsMutex_;
+	// The worker pool for offloaded handlers:
+	std::vector<std::thread> workers_;
+	std::deque<std::function<void()>> work_;
+	std::mutex workMutex_;
+	std::condition_variable workAvailable_;
+	unsigned numWorkers_;
+	std::size_t maxQueuedWork_;
+	bool stopWorkers_;
 	
-	void server();
-	void session(std::shared_ptr<boost::asio::ip::tcp::socket> sock);
-	void cleanUpExpiredSockets();
+	void acceptConnection(Acceptor& acceptor, Strand& strand, const std::string& endpointName);
+	void closeAcceptor();
+	void runIOService(boost::asio::io_service& ioService);
 	void stopAcceptingConnections();
-	std::string applyHTMLFormatting(const std::string& s, const std::string& title);
-	std::string insertOutputFieldSeparator(std::string prefix, const std::string& s);
+	void addSession(Session* session);
+	void removeSession(Session* session);
+	void closeSessions();
+	void abandonOffloadedHandlers(); // by the destructor, so that their Completions do nothing if called later
+	bool reserveSession(); // false at maxSessions_; otherwise the next Session takes the slot, or releaseSession() frees it
+	void releaseSession();
+	void rejectConnection(std::shared_ptr<Socket> sock); // with an explicit error, rather than a hang
+	bool offload(const std::function<void()>& job); // false if the queue is full
+	void runWorker();
+	void stopWorkerPool();
+	std::shared_ptr<Topic> topic(std::string_view name); // created on first use
 public:
 	enum class Sync { blocking, non_blocking };
+	typedef std::shared_ptr<const std::string> SharedReply;
+		// Command handlers are looked up in FunctionRegistry<SharedReply, std::string_view>, then <std::string, std::string_view>,
+		// then <std::string, const std::string&>; web handlers in <SharedReply, const CGIViewMap&>, <std::string, const CGIViewMap&>
+		// (see classHTTPParser.h), then <SharedReply, const CGImap&>, and <std::string, const CGImap&>.
+		// Web requests are HTTP/1.1 GETs with a query string, or POSTs of a form (see classHTTPParser.h), whose field
+		// webCommandStr names the handler; a browser may send many over one keep-alive connection.
+		// A SharedReply is an immutable buffer sent without copying, e.g. one that is rebuilt only when its contents
+		// change, and shared by all the clients that ask for it.
+	typedef std::function<void(SharedReply reply, bool isError)> Completion;
+		// Slow handlers can instead be registered in FunctionRegistry<void, std::string_view, const Completion&>, as
+		// void f(std::string_view argument, const SocketServer::Completion& done). They run on the worker pool, and
+		// call done once, from any thread, possibly after returning; the session meanwhile serves its other requests.
+		// A Completion called, or destroyed, after the server's destructor has started does nothing.
+		// Replies to tagged frames (see classSocketFrame.h) are sent as they complete; the others keep request order.
+		// Either kind of handler is called only on a cache miss if its command was declared in ReplyCache (classReplyCache.h).
+		// The reserved command Stats, and web command Stats (see setWebStats()), report each command's calls, errors, bytes,
+		// and percentiles of the time spent in its handler and waiting for it; Stats__+__command reports on that command
+		// alone. launchServer() refuses to start if a handler is registered as Stats, or (not for the web) Subscribe.
 
 	SocketServer(Logger* theLogger, short port, const std::string& htmlHeaderFooterFileName, const bool isHTTPS = false, const std::string& cmdArgSeparatorTag = "__+__", const std::string& outResultSeparatorTag = "__$__", const std::string& inputFieldSeparatorTag = "__*__", const std::string& webCommandStr = "WebCommand");
 	SocketServer(const SocketServer&) = delete;
@@ -86,7 +155,38 @@ public:
 	const std::string& itsOutputFieldSeparator() const { return outputFieldSeparator_; }
 	const std::string& itsInputFieldSeparator() const { return inputFieldSeparator_; }
 	const std::string& httpType() const { return httpType_; }
-	void launchServer(Sync isBlocking);
+	void listenOnUnixSocket(const std::string& socketPath);
+		// Also accepts connections from local processes at socketPath; call before launchServer(). Clients running
+		// as this user authenticate by their credentials (SO_PEERCRED), without the AuthStep1 file round trip.
+	void publish(std::string_view topic, SharedReply value);
+	void publish(std::string_view topic, std::string value) { publish(topic, std::make_shared<const std::string>(std::move(value))); }
+		// Pushes value to the clients that sent Subscribe__+__topic (or topic__*__maxUpdatesPerSecond), without blocking
+		// the caller, e.g. the Mind once per cycle. A client that is slow, or limited to a lower rate, gets only the
+		// latest value when it can take one. Text-mode subscribers are not sent values containing '\n' or "Error:",
+		// which their line framing cannot carry; clients that need such values should subscribe in framed mode.
+		// maxUpdatesPerSecond is 0 for unlimited, or at least 0.001; other rates are rejected.
+	void setSessionTimeouts(std::chrono::steady_clock::duration idleTimeout, std::chrono::steady_clock::duration readTimeout);
+		// A session is closed once it has waited idleTimeout for a request (if it has no replies pending and no
+		// subscriptions), or readTimeout for the rest of a request, or to authenticate, or for the next HTTP request
+		// on a keep-alive connection. Zero disables either; the defaults are no idle timeout, and a 30 s read timeout.
+	void setAdmissionLimits(std::size_t maxSessions, std::size_t maxInFlightRequests, std::size_t maxQueuedBytes);
+		// Beyond maxSessions, a new connection gets a single "Error: ..." line and is closed at once. A session stops
+		// reading once maxInFlightRequests of its requests have replies not yet written, or its unwritten replies reach
+		// maxQueuedBytes, so that the client's writes block (TCP backpressure) until it catches up. Zero disables a
+		// limit; the defaults are 4096 sessions, 1024 requests, and 16 MiB. Call before launchServer().
+	void setAcceptorShards(unsigned numShards);
+		// numShards > 1 (0: one per hardware thread): listens on the port with that many SO_REUSEPORT acceptors, each
+		// with its own thread, which also serves the sessions it accepts, so that the kernel spreads new connections
+		// across cores. The numThreads of launchServer() then serve the Unix domain socket only. Call before launchServer().
+	void setWebStats(bool enable);
+		// Off by default, as web requests, unlike text and framed ones, are not authenticated. Call before launchServer().
+	void setWorkerPool(unsigned numWorkers, std::size_t maxQueuedHandlers);
+		// For offloaded handlers; call before launchServer(). The defaults are one worker per hardware thread,
+		// and 1024 queued handlers, beyond which requests get a "server is busy" error at once.
+	void launchServer(Sync isBlocking, unsigned numThreads = 0);
+		// Serves all connections from a pool of numThreads threads (0: one per hardware thread).
+		// Handlers registered with FunctionRegistry run on those threads, so a slow handler occupies one of them,
+		// unless it is offloaded (see Completion).
 };
 
 #endif
@@ -0,0 +1,137 @@
+// NGI Log Tools
+// ngilogdecode.cpp
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Converts a binary run log, written by Logger after openBinaryRunLog(), into the tab-separated text format of a run log.
+
+#include "classCmdLineArgParser.h"
+#include "classLogFormat.h"
+#include "classLogger.h"
+#include "commandLineApplicationSupport.h"
+#include "ngiFileUtilities.h"
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+std::string version() { return "ngilogdecode v1.0"; }
+
+void printUsage(const std::string& programName, bool doExit)
+{
+	std::cout << "Usage:\n";
+	std::cout << programName << " -i binary_run_log [ -o text_run_log ]\n";
+	std::cout << "Note: the text is written to standard output if -o is not specified" << std::endl;
+	if (doExit) std::exit(1);
+}
+
+void decodeBinaryRunLog(const std::string& binaryLog, std::ostream& out)
+{
+	const std::string data(readFileIntoString(binaryLog));
+	const std::size_t magicLength = sizeof(LogFormat::fileMagic) - 1;
+	if (data.compare(0, magicLength, LogFormat::fileMagic) != 0) {
+		throw std::runtime_error(binaryLog + " is not a binary run log");
+	}
+	const char* p = data.data() + magicLength;
+	const char* const end = data.data() + data.length();
+	auto readString = [&p, end](std::size_t length) {
+		if (static_cast<std::size_t>(end - p) < length) {
+			throw std::runtime_error("decodeBinaryRunLog(): truncated record");
+		}
+		std::string_view s(p, length);
+		p += length;
+		return s;
+	};
+	const std::string prefixTail(readString(readRaw<std::uint32_t>(p, end)));
+	std::map<std::uint32_t, std::string> formats;
+	std::string timestamp;
+	out << Logger::runLogHeader();
+	while (p != end) {
+		const char recordType = readRaw<char>(p, end);
+		switch (recordType) {
+			case LogFormat::_definitionRecord_: {
+				const std::uint32_t id = readRaw<std::uint32_t>(p, end);
+				formats[id] = readString(readRaw<std::uint32_t>(p, end));
+				break;
+			}
+			case LogFormat::_timestampRecord_:
+				readRaw<std::int64_t>(p, end); // seconds since the epoch; the formatted text follows
+				timestamp = readString(readRaw<std::uint8_t>(p, end));
+				break;
+			case LogFormat::_logRecord_: {
+				const std::uint32_t id = readRaw<std::uint32_t>(p, end);
+				readRaw<std::uint8_t>(p, end); // log level
+				const std::string_view encodedArguments(readString(readRaw<std::uint32_t>(p, end)));
+				const auto format = formats.find(id);
+				if (format == formats.end()) {
+					throw std::runtime_error("decodeBinaryRunLog(): format " + std::to_string(id) + " used before being defined");
+				}
+				out << timestamp << prefixTail << expandLogFormat(format->second, encodedArguments) << '\n';
+				break;
+			}
+			default:
+				throw std::runtime_error(std::string("decodeBinaryRunLog(): unknown record type ") + recordType);
+		}
+	}
+}
+
+int main(const int argc, const char* argv[])
+{
+	CmdLineArgParser options(argc, argv);
+	if (argc == 1) { // Asking for usage
+		printUsage(options.programName(), true);
+	}
+	std::string binaryLogName, textLogName;
+	try {
+		options.parse("-i", &binaryLogName, true);
+		options.parse("-o", &textLogName);
+		if (options.hasExtraneousArguments()) {
+			throw std::runtime_error("Extraneous arguments on command line");
+		}
+	} catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		printUsage(options.programName(), true);
+	}
+	try {
+		if (textLogName.empty()) {
+			decodeBinaryRunLog(binaryLogName, std::cout);
+		} else {
+			std::ofstream textLog(textLogName);
+			if (!textLog.is_open()) {
+				throw std::runtime_error("Cannot open " + textLogName);
+			}
+			decodeBinaryRunLog(binaryLogName, textLog);
+		}
+	} catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
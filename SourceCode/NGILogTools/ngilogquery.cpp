@@ -0,0 +1,96 @@
+// NGI Log Tools
+// ngilogquery.cpp
+// Version 2026.10.16
+
+/*
+Copyright (c) 2026, NeuroGadgets Inc.
+Author: Robert L. Charlebois
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of NeuroGadgets Inc. nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Lists the master log entries in a time range, optionally filtered by host, user, data ID, program and level.
+// Uses the sidecar index written by Logger after enableMasterLogIndex(); without one, the whole log is scanned.
+
+#include "classCmdLineArgParser.h"
+#include "classLogQuery.h"
+#include "classLogger.h"
+#include "commandLineApplicationSupport.h"
+#include <iostream>
+#include <string>
+
+std::string version() { return "ngilogquery v1.0"; }
+
+void printUsage(const std::string& programName, bool doExit)
+{
+	std::cout << "Usage:\n";
+	std::cout << programName << " -m master_log [ -from \"YYYY-MM-DD HH:MM:SS\" ] [ -to \"YYYY-MM-DD HH:MM:SS\" ] [ -host host_name ] [ -user user_name ] [ -data data_ID ] [ -program program_name ] [ -level warn|error ] [ -slack seconds ]\n";
+	std::cout << "Note: times are local, both ends are inclusive, and the matching entries are written to standard output" << std::endl;
+	if (doExit) std::exit(1);
+}
+
+int main(const int argc, const char* argv[])
+{
+	CmdLineArgParser options(argc, argv);
+	if (argc == 1) { // Asking for usage
+		printUsage(options.programName(), true);
+	}
+	std::string masterLogName, from, to, level;
+	LogQuery::Filter filter;
+	try {
+		options.parse("-m", &masterLogName, true);
+		options.parse("-from", &from);
+		options.parse("-to", &to);
+		options.parse("-host", &filter.hostName);
+		options.parse("-user", &filter.userName);
+		options.parse("-data", &filter.dataID);
+		options.parse("-program", &filter.programName);
+		options.parse("-level", &level);
+		options.parse("-slack", &filter.slackSeconds);
+		if (options.hasExtraneousArguments()) {
+			throw std::runtime_error("Extraneous arguments on command line");
+		}
+		if (!from.empty()) filter.from = LogQuery::parseLocalTime(from);
+		if (!to.empty()) filter.to = LogQuery::parseLocalTime(to);
+		if (level == "warn") {
+			filter.minLevel = Logger::_warn_;
+		} else if (level == "error") {
+			filter.minLevel = Logger::_error_;
+		} else if (!level.empty()) {
+			throw std::runtime_error("-level must be warn or error");
+		}
+	} catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		printUsage(options.programName(), true);
+	}
+	try {
+		const LogQuery query(masterLogName);
+		query.forEach(filter, [](std::string_view line) { std::cout << line << '\n'; });
+		std::cout.flush();
+	} catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}